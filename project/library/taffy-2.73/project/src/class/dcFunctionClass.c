@@ -1157,7 +1157,7 @@ dcNode *dcFunctionClass_getGraphDataBody(dcNode *_receiver)
             (dcProcedureClass_getBody(dcClass_getSuperNode(_receiver))));
 }
 
-dcNode *dcFunctionClass_getBody(dcNode *_receiver)
+dcNode *dcFunctionClass_getBody(const dcNode *_receiver)
 {
     return dcProcedureClass_getBody(dcClass_getSuperNode(_receiver));
 }
@@ -96,7 +96,7 @@ TAFFY_C_METHOD(dcFunctionMetaClass_createWithBlock);
 TAFFY_C_METHOD(dcFunctionMetaClass_setDefaultMemorySize);
 TAFFY_C_METHOD(dcFunctionMetaClass_getDefaultMemorySize);
 
-struct dcNode_t *dcFunctionClass_getBody(struct dcNode_t *_receiver);
+struct dcNode_t *dcFunctionClass_getBody(const struct dcNode_t *_receiver);
 struct dcNode_t *dcFunctionClass_getGraphDataBody(struct dcNode_t *_receiver);
 
 dcResult dcFunctionClass_compileHelper(struct dcNode_t *_function,
@@ -29,6 +29,10 @@
 #include "dcString.h"
 #include "dcUnsignedInt32.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 ///////////////////
 // dcHashElement //
 ///////////////////
@@ -154,25 +158,249 @@ void dcHashElement_registerNode(dcNode *_hashElementNode)
 // dcHash //
 ////////////
 
+//
+// dcHash is an open addressing table. Each slot has a control byte, and
+// probes look at a group of control bytes at a time, so most misses never
+// touch a slot. Removing leaves a tombstone, which is only cleared by a
+// rehash
+//
+
+// a control byte is one of these, or the top 7 bits of a full slot's hash
+#define CONTROL_EMPTY   ((uint8_t)0x80)
+#define CONTROL_DELETED ((uint8_t)0xFE)
+
+#define IS_FULL(_control) ((_control) < 0x80)
+
+#ifdef __SSE2__
+
+// a group is 16 control bytes, matched into one bit per byte
+#define GROUP_WIDTH 16
+#define GROUP_SHIFT 0
+
+typedef uint32_t dcHashGroupMask;
+
+static inline dcHashGroupMask matchHash(const uint8_t *_group, uint8_t _h2)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *)_group);
+    return (dcHashGroupMask)(_mm_movemask_epi8
+                             (_mm_cmpeq_epi8(group,
+                                             _mm_set1_epi8((char)_h2))));
+}
+
+static inline dcHashGroupMask matchEmpty(const uint8_t *_group)
+{
+    return matchHash(_group, CONTROL_EMPTY);
+}
+
+static inline dcHashGroupMask matchEmptyOrDeleted(const uint8_t *_group)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *)_group);
+    return (dcHashGroupMask)_mm_movemask_epi8(group);
+}
+
+#else
+
+// a group is 8 control bytes in a word, matched into the top bit of each
+#define GROUP_WIDTH 8
+#define GROUP_SHIFT 3
+
+typedef uint64_t dcHashGroupMask;
+
+#define GROUP_LSBS 0x0101010101010101ULL
+#define GROUP_MSBS 0x8080808080808080ULL
+
+static inline uint64_t loadGroup(const uint8_t *_group)
+{
+    uint64_t result;
+    memcpy(&result, _group, sizeof(result));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    result = __builtin_bswap64(result);
+#endif
+    return result;
+}
+
+// this can also match the byte after a real match, but the slot's full
+// hash is compared anyway
+static inline dcHashGroupMask matchHash(const uint8_t *_group, uint8_t _h2)
+{
+    uint64_t group = loadGroup(_group) ^ (GROUP_LSBS * _h2);
+    return (group - GROUP_LSBS) & ~group & GROUP_MSBS;
+}
+
+static inline dcHashGroupMask matchEmpty(const uint8_t *_group)
+{
+    uint64_t group = loadGroup(_group);
+    return group & ~(group << 6) & GROUP_MSBS;
+}
+
+static inline dcHashGroupMask matchEmptyOrDeleted(const uint8_t *_group)
+{
+    return loadGroup(_group) & GROUP_MSBS;
+}
+
+#endif
+
+// the index in the group of the lowest match in _mask, which can't be 0
+static inline dcHashCapacityType lowestMatch(dcHashGroupMask _mask)
+{
+#ifdef __GNUC__
+    return (dcHashCapacityType)__builtin_ctzll(_mask) >> GROUP_SHIFT;
+#else
+    dcHashCapacityType result = 0;
+
+    while ((_mask & 1) == 0)
+    {
+        _mask >>= 1;
+        result++;
+    }
+
+    return result >> GROUP_SHIFT;
+#endif
+}
+
+//
+// hashes from Taffy aren't well spread, so multiply them up. h1 picks where
+// a probe starts, and h2 goes in the control byte
+//
+static inline uint64_t mixHash(dcHashType _hash)
+{
+    uint64_t hash = (uint64_t)_hash;
+    return (hash ^ (hash >> 32)) * 0x9E3779B97F4A7C15ULL;
+}
+
+#define H1(_mixed) ((dcHashCapacityType)((_mixed) >> 25))
+#define H2(_mixed) ((uint8_t)((_mixed) >> 57))
+
+// keep at least an eighth of the slots empty, so every probe ends
+static dcHashCapacityType getMaxLoad(dcHashCapacityType _capacity)
+{
+    return _capacity - _capacity / 8;
+}
+
+static void setControl(dcHash *_hash,
+                       dcHashCapacityType _index,
+                       uint8_t _control)
+{
+    _hash->controls[_index] = _control;
+
+    if (_index < GROUP_WIDTH)
+    {
+        _hash->controls[_hash->capacity + _index] = _control;
+    }
+}
+
+static void allocateSlots(dcHash *_hash, dcHashCapacityType _capacity)
+{
+    _hash->controls = (uint8_t *)dcMemory_allocate(_capacity + GROUP_WIDTH);
+    memset(_hash->controls, CONTROL_EMPTY, _capacity + GROUP_WIDTH);
+    _hash->slots = (dcHashSlot *)(dcMemory_allocate
+                                  (sizeof(dcHashSlot) * _capacity));
+    _hash->capacity = _capacity;
+    _hash->growthLeft = getMaxLoad(_capacity);
+}
+
+// the first empty or deleted slot on the probe sequence for _mixed
+static dcHashCapacityType findFreeSlot(const dcHash *_hash, uint64_t _mixed)
+{
+    dcHashCapacityType mask = _hash->capacity - 1;
+    dcHashCapacityType position = H1(_mixed) & mask;
+    dcHashCapacityType step = 0;
+    dcHashGroupMask candidates;
+
+    while ((candidates = matchEmptyOrDeleted(_hash->controls + position))
+           == 0)
+    {
+        step += GROUP_WIDTH;
+        position = (position + step) & mask;
+    }
+
+    return (position + lowestMatch(candidates)) & mask;
+}
+
+static void resize(dcHash *_hash, dcHashCapacityType _capacity)
+{
+    uint8_t *controls = _hash->controls;
+    dcHashSlot *slots = _hash->slots;
+    dcHashCapacityType capacity = _hash->capacity;
+    dcHashCapacityType i;
+
+    allocateSlots(_hash, _capacity);
+
+    for (i = 0; i < capacity; i++)
+    {
+        if (IS_FULL(controls[i]))
+        {
+            uint64_t mixed = mixHash(slots[i].hash);
+            dcHashCapacityType index = findFreeSlot(_hash, mixed);
+            setControl(_hash, index, H2(mixed));
+            _hash->slots[index] = slots[i];
+        }
+    }
+
+    _hash->growthLeft -= _hash->size;
+    dcMemory_free(controls);
+    dcMemory_free(slots);
+}
+
+// find a slot for a new element, rehashing if we're out of room
+static dcHashCapacityType prepareSet(dcHash *_hash, uint64_t _mixed)
+{
+    if (_hash->capacity == 0)
+    {
+        allocateSlots(_hash, DEFAULT_HASH_CAPACITY);
+    }
+
+    dcHashCapacityType index = findFreeSlot(_hash, _mixed);
+
+    if (_hash->growthLeft == 0
+        && _hash->controls[index] == CONTROL_EMPTY)
+    {
+        // if it's mostly tombstones, sweep them out instead of growing
+        dcHashCapacityType capacity = _hash->capacity;
+        dcError_assert(capacity < 0x80000000);
+        resize(_hash,
+               (_hash->size <= getMaxLoad(capacity) / 2
+                ? capacity
+                : capacity * 2));
+        index = findFreeSlot(_hash, _mixed);
+    }
+
+    if (_hash->controls[index] == CONTROL_EMPTY)
+    {
+        _hash->growthLeft--;
+    }
+
+    return index;
+}
+
 dcHash *dcHash_create(void)
 {
-    return dcHash_createWithCapacity(DEFAULT_HASH_CAPACITY);
+    return dcHash_createWithCapacity(0);
 }
 
 dcNode *dcHash_createNode(void)
 {
-    return (dcNode_createWithGuts
-            (NODE_HASH,
-             dcHash_createWithCapacity(DEFAULT_HASH_CAPACITY)));
+    return dcNode_createWithGuts(NODE_HASH, dcHash_create());
 }
 
-dcHash *dcHash_createWithCapacity(uint16_t _capacity)
+dcHash *dcHash_createWithCapacity(dcHashCapacityType _capacity)
 {
-    dcHash *hash = (dcHash *)dcMemory_allocate(sizeof(dcHash));
-    hash->buckets = (dcList **)(dcMemory_allocateAndInitialize
-                                (sizeof(dcList *) * _capacity));
-    hash->capacity = _capacity;
-    hash->size = 0;
+    dcHash *hash = (dcHash *)dcMemory_allocateAndInitialize(sizeof(dcHash));
+
+    // otherwise the slots are allocated on the first set
+    if (_capacity > 0)
+    {
+        dcHashCapacityType capacity = DEFAULT_HASH_CAPACITY;
+
+        while (getMaxLoad(capacity) < _capacity)
+        {
+            dcError_assert(capacity < 0x80000000);
+            capacity *= 2;
+        }
+
+        allocateSlots(hash, capacity);
+    }
+
     return hash;
 }
 
@@ -181,18 +409,18 @@ void dcHash_free(dcHash **_hash, dcDepth _depth)
     if (*_hash != NULL)
     {
         dcHash *hash = *_hash;
+        dcHashCapacityType i;
 
-        if (hash->buckets != NULL)
+        for (i = 0; i < hash->capacity; i++)
         {
-            uint16_t i;
-
-            for (i = 0; i < hash->capacity; i++)
+            if (IS_FULL(hash->controls[i]))
             {
-                dcList_free(&hash->buckets[i], _depth);
+                dcNode_tryFree(&hash->slots[i].element, _depth);
             }
-
-            dcMemory_free(hash->buckets);
         }
+
+        dcMemory_free(hash->controls);
+        dcMemory_free(hash->slots);
     }
 
     dcMemory_free(*_hash);
@@ -205,121 +433,116 @@ dcHashIterator *dcHash_createIterator(const dcHash *_hash)
 
 void dcHash_markNode(dcNode *_hash)
 {
-    dcHash *hash = CAST_HASH(_hash);
-    uint16_t i;
-
-    for (i = 0; i < hash->capacity; i++)
-    {
-        dcList_mark(hash->buckets[i]);
-    }
+    dcHash_mark(CAST_HASH(_hash));
 }
 
 void dcHash_register(dcHash *_hash)
 {
     if (_hash != NULL)
     {
-        uint16_t i;
+        dcHashCapacityType i;
 
         for (i = 0; i < _hash->capacity; i++)
         {
-            dcList_register(_hash->buckets[i]);
+            if (IS_FULL(_hash->controls[i]))
+            {
+                dcNode_register(_hash->slots[i].element);
+            }
         }
     }
 }
 
-static void set(dcHash *_hash, dcNode *_hashElement)
+static dcResult compareKeys(const dcHashElementKey *_elementKey,
+                            const dcHashElementKey *_key)
 {
-    dcHashElement *element = CAST_HASH_ELEMENT(_hashElement);
-    dcContainerSizeType k = element->key.hash % _hash->capacity;
-    dcList *list = _hash->buckets[k];
+    dcResult result = TAFFY_FAILURE;
 
-    if (list == NULL)
+    if (_elementKey->isNodeKey == _key->isNodeKey)
     {
-        list = dcList_create();
-        _hash->buckets[k] = list;
+        dcResult compareResult = TAFFY_SUCCESS;
+        dcTaffyOperator compareOperator = TAFFY_EQUALS;
+
+        if (_elementKey->isNodeKey)
+        {
+            compareResult = dcNode_compareEqual(_elementKey->keyUnion.nodeKey,
+                                                _key->keyUnion.nodeKey,
+                                                &compareOperator);
+        }
+        else
+        {
+            compareOperator = dcMemory_taffyStringCompare
+                (_elementKey->keyUnion.stringKey,
+                 _key->keyUnion.stringKey);
+        }
+
+        if (compareResult == TAFFY_EXCEPTION)
+        {
+            result = TAFFY_EXCEPTION;
+        }
+        else if (compareResult == TAFFY_SUCCESS
+                 && compareOperator == TAFFY_EQUALS)
+        {
+            result = TAFFY_SUCCESS;
+        }
     }
 
-    dcList_push(list, _hashElement);
-    _hash->size++;
+    return result;
 }
 
-static float sLoadFactor = 0.75;
-
 static dcResult getHashElementWithKeys(const dcHash *_hash,
                                        dcHashElementKey *_key,
                                        dcNode **_getResult,
-                                       dcList **_listResult,
-                                       dcListElement **_listElementResult)
+                                       dcHashCapacityType *_indexResult)
 {
     dcResult result = TAFFY_FAILURE;
-    dcList *bucket = _hash->buckets[_key->hash % _hash->capacity];
 
-    if (bucket != NULL)
+    if (_hash->capacity > 0)
     {
-        FOR_EACH_IN_LIST(bucket, that)
+        uint64_t mixed = mixHash(_key->hash);
+        uint8_t h2 = H2(mixed);
+        dcHashCapacityType mask = _hash->capacity - 1;
+        dcHashCapacityType position = H1(mixed) & mask;
+        dcHashCapacityType step = 0;
+        bool done = false;
+
+        while (! done)
         {
-            dcHashElement *element = CAST_HASH_ELEMENT(that->object);
+            const uint8_t *group = _hash->controls + position;
+            dcHashGroupMask matches = matchHash(group, h2);
 
-            if (element->key.hash == _key->hash)
+            while (matches != 0 && ! done)
             {
-                // we have preliminary success...
-                dcResult myResult = TAFFY_SUCCESS;
-                dcTaffyOperator compareResult = TAFFY_EQUALS;
+                dcHashCapacityType index =
+                    (position + lowestMatch(matches)) & mask;
+                const dcHashSlot *slot = &_hash->slots[index];
+                matches &= matches - 1;
 
-                if (_key != NULL)
+                if (slot->hash == _key->hash)
                 {
-                    // both the key and keyHash were given, so do a comparison
-                    if (element->key.isNodeKey == _key->isNodeKey)
+                    result = compareKeys(&CAST_HASH_ELEMENT(slot->element)->key,
+                                         _key);
+
+                    if (result == TAFFY_SUCCESS)
                     {
-                        if (element->key.isNodeKey)
+                        if (_getResult != NULL)
                         {
-                            myResult = dcNode_compareEqual
-                                (element->key.keyUnion.nodeKey,
-                                 _key->keyUnion.nodeKey,
-                                 &compareResult);
+                            *_getResult = slot->element;
                         }
-                        else
+
+                        if (_indexResult != NULL)
                         {
-                            myResult = TAFFY_SUCCESS;
-                            compareResult = dcMemory_taffyStringCompare
-                                (element->key.keyUnion.stringKey,
-                                 _key->keyUnion.stringKey);
+                            *_indexResult = index;
                         }
                     }
-                    else
-                    {
-                        compareResult = TAFFY_LESS_THAN;
-                    }
-                }
 
-                if (myResult == TAFFY_SUCCESS
-                    && compareResult == TAFFY_EQUALS)
-                {
-                    result = TAFFY_SUCCESS;
-
-                    if (_getResult != NULL)
-                    {
-                        *_getResult = that->object;
-                    }
-
-                    if (_listElementResult != NULL)
-                    {
-                        *_listElementResult = that;
-                    }
-
-                    if (_listResult != NULL)
-                    {
-                        *_listResult = bucket;
-                    }
-
-                    break;
-                }
-                else if (myResult == TAFFY_EXCEPTION)
-                {
-                    result = TAFFY_EXCEPTION;
-                    break;
+                    done = (result != TAFFY_FAILURE);
                 }
             }
+
+            // an empty slot ends the probe, the key would've gone there
+            done = done || matchEmpty(group) != 0;
+            step += GROUP_WIDTH;
+            position = (position + step) & mask;
         }
     }
 
@@ -332,11 +555,8 @@ static dcResult setValue(dcHash *_hash,
 {
     dcNode *element = NULL;
     dcResult result = TAFFY_FAILURE;
-    dcResult getResult = getHashElementWithKeys(_hash,
-                                                _key,
-                                                &element,
-                                                NULL,
-                                                NULL);
+    dcResult getResult = getHashElementWithKeys(_hash, _key, &element, NULL);
+
     if (getResult == TAFFY_EXCEPTION)
     {
         result = TAFFY_EXCEPTION;
@@ -361,42 +581,12 @@ static dcResult setValue(dcHash *_hash,
         }
         else
         {
-            element = createHashElementNode(_key, _value);
-            set(_hash, element);
-        }
-
-        //
-        // rehash if needed!
-        // overflow possibility
-        //
-        if ((float)_hash->size * sLoadFactor >= _hash->capacity)
-        {
-            dcHash *tempHash =
-                dcHash_createWithCapacity(_hash->capacity * 2);
-            dcHashIterator *i = dcHash_createIterator(_hash);
-            dcNode *that = NULL;
-
-            while ((that = dcHashIterator_getNext(i))
-                   != NULL)
-            {
-                set(tempHash, that);
-            }
-
-            // perform a bucket switcheroo!
-            dcContainerSizeType j;
-
-            for (j = 0; j < _hash->capacity; j++)
-            {
-                dcList_free(&_hash->buckets[j], DC_FLOATING);
-            }
-
-            dcMemory_free(_hash->buckets);
-
-            _hash->buckets = tempHash->buckets;
-            _hash->capacity = tempHash->capacity;
-            tempHash->buckets = NULL;
-            dcHash_free(&tempHash, DC_DEEP);
-            dcHashIterator_free(&i);
+            uint64_t mixed = mixHash(_key->hash);
+            dcHashCapacityType index = prepareSet(_hash, mixed);
+            setControl(_hash, index, H2(mixed));
+            _hash->slots[index].hash = _key->hash;
+            _hash->slots[index].element = createHashElementNode(_key, _value);
+            _hash->size++;
         }
     }
 
@@ -459,7 +649,6 @@ dcResult dcHash_getHashElement(const dcHash *_hash,
             ? getHashElementWithKeys(_hash,
                                      &key,
                                      _result,
-                                     NULL,
                                      NULL)
             : hashResult);
 }
@@ -489,7 +678,6 @@ dcResult dcHash_getValueWithKeys(const dcHash *_hash,
     return (extractValue(getHashElementWithKeys(_hash,
                                                 &key,
                                                 _value,
-                                                NULL,
                                                 NULL),
                          _value));
 }
@@ -520,19 +708,34 @@ dcResult dcHash_getValueWithStringKeys(const dcHash *_hash,
     return (extractValue(getHashElementWithKeys(_hash,
                                                 &key,
                                                 _value,
-                                                NULL,
                                                 NULL),
                          _value));
 }
 
 dcHash *dcHash_copy(const dcHash *_from, dcDepth _depth)
 {
-    dcHash *result = dcHash_createWithCapacity(_from->capacity);
-    uint16_t i;
+    dcHash *result = dcHash_create();
 
-    for (i = 0; i < _from->capacity; i++)
+    if (_from->capacity > 0)
     {
-        result->buckets[i] = dcList_copy(_from->buckets[i], _depth);
+        dcHashCapacityType i;
+
+        allocateSlots(result, _from->capacity);
+        memcpy(result->controls,
+               _from->controls,
+               _from->capacity + GROUP_WIDTH);
+
+        for (i = 0; i < _from->capacity; i++)
+        {
+            if (IS_FULL(_from->controls[i]))
+            {
+                result->slots[i].hash = _from->slots[i].hash;
+                result->slots[i].element =
+                    dcNode_tryCopy(_from->slots[i].element, _depth);
+            }
+        }
+
+        result->growthLeft = _from->growthLeft;
     }
 
     result->size = _from->size;
@@ -541,14 +744,21 @@ dcHash *dcHash_copy(const dcHash *_from, dcDepth _depth)
 
 void dcHash_clear(dcHash *_hash, dcDepth _depth)
 {
-    if (_hash != NULL)
+    if (_hash != NULL && _hash->capacity > 0)
     {
-        uint16_t i = 0;
+        dcHashCapacityType i;
 
         for (i = 0; i < _hash->capacity; i++)
         {
-            dcList_clear(_hash->buckets[i], _depth);
+            if (IS_FULL(_hash->controls[i]))
+            {
+                dcNode_tryFree(&_hash->slots[i].element, _depth);
+            }
         }
+
+        memset(_hash->controls, CONTROL_EMPTY, _hash->capacity + GROUP_WIDTH);
+        _hash->growthLeft = getMaxLoad(_hash->capacity);
+        _hash->size = 0;
     }
 }
 
@@ -556,11 +766,14 @@ void dcHash_mark(dcHash *_hash)
 {
     if (_hash != NULL)
     {
-        uint16_t i;
+        dcHashCapacityType i;
 
         for (i = 0; i < _hash->capacity; i++)
         {
-            dcList_mark(_hash->buckets[i]);
+            if (IS_FULL(_hash->controls[i]))
+            {
+                dcNode_mark(_hash->slots[i].element);
+            }
         }
     }
 }
@@ -568,16 +781,14 @@ void dcHash_mark(dcHash *_hash)
 dcArray *dcHash_getValues(const dcHash *_hash)
 {
     dcArray *values = dcArray_createWithSize(_hash->size);
-    size_t i = 0;
+    dcHashCapacityType i;
 
     for (i = 0; i < _hash->capacity; i++)
     {
-        if (_hash->buckets[i] != NULL)
+        if (IS_FULL(_hash->controls[i]))
         {
-            FOR_EACH_IN_LIST(_hash->buckets[i], that)
-            {
-                dcArray_add(values, CAST_HASH_ELEMENT(that->object)->value);
-            }
+            dcArray_add(values,
+                        CAST_HASH_ELEMENT(_hash->slots[i].element)->value);
         }
     }
 
@@ -614,14 +825,12 @@ static dcResult dcHash_remove(dcHash *_hash,
                               dcDepth _depth)
 {
     dcNode *hashElementNode = NULL;
-    dcListElement *listElement = NULL;
-    dcList *list = NULL;
+    dcHashCapacityType index = 0;
 
     dcResult result = getHashElementWithKeys(_hash,
                                              _key,
                                              &hashElementNode,
-                                             &list,
-                                             &listElement);
+                                             &index);
 
     if (result == TAFFY_SUCCESS)
     {
@@ -630,7 +839,10 @@ static dcResult dcHash_remove(dcHash *_hash,
             *_removed = CAST_HASH_ELEMENT(hashElementNode)->value;
         }
 
-        dcList_removeElement(list, &listElement, _depth);
+        // leave a tombstone, so probes that passed through here still work
+        setControl(_hash, index, CONTROL_DELETED);
+        _hash->slots[index].element = NULL;
+        dcNode_tryFree(&hashElementNode, _depth);
         dcError_assert(_hash->size > 0);
         _hash->size--;
     }
@@ -727,23 +939,7 @@ dcTaffy_createMarshallNodeFunctionMacro(dcHash, CAST_HASH);
 
 void dcHashIterator_reset(dcHashIterator *_iterator)
 {
-    if (_iterator->hash != NULL)
-    {
-        _iterator->bucketIt = 0;
-        _iterator->element = NULL;
-
-        while (_iterator->bucketIt < _iterator->hash->capacity
-               && _iterator->hash->buckets[_iterator->bucketIt] == NULL)
-        {
-            _iterator->bucketIt++;
-        }
-
-        if (_iterator->bucketIt < _iterator->hash->capacity)
-        {
-            _iterator->element =
-                _iterator->hash->buckets[_iterator->bucketIt]->head;
-        }
-    }
+    _iterator->slot = 0;
 }
 
 dcHashIterator *dcHashIterator_create(const dcHash *_hash)
@@ -751,7 +947,6 @@ dcHashIterator *dcHashIterator_create(const dcHash *_hash)
     dcHashIterator *iterator = (dcHashIterator *)(dcMemory_allocate
                                                   (sizeof(dcHashIterator)));
     iterator->hash = _hash;
-    iterator->element = NULL;
     dcHashIterator_reset(iterator);
     return iterator;
 }
@@ -764,44 +959,19 @@ void dcHashIterator_free(dcHashIterator **_iterator)
 dcNode *dcHashIterator_getNext(dcHashIterator *_iterator)
 {
     dcNode *result = NULL;
+    const dcHash *hash = _iterator->hash;
 
-    if (_iterator->hash != NULL)
+    if (hash != NULL)
     {
-        // try to iterate along the list first //
-        if (_iterator->element != NULL)
-        {
-            result = _iterator->element->object;
-            _iterator->element = _iterator->element->next;
-        }
-        else
+        while (result == NULL && _iterator->slot < hash->capacity)
         {
-            // fail. find a non-null bucket //
-            _iterator->bucketIt++;
-
-            while (_iterator->bucketIt < _iterator->hash->capacity
-                   && (_iterator->hash->buckets[_iterator->bucketIt] == NULL
-                       || (_iterator->hash->buckets[_iterator->bucketIt]->size
-                           == 0)))
+            if (IS_FULL(hash->controls[_iterator->slot]))
             {
-                _iterator->bucketIt++;
+                result = hash->slots[_iterator->slot].element;
             }
 
-            // did we really find a woot bucket? //
-            if (_iterator->bucketIt < _iterator->hash->capacity)
-            {
-                // grab the list //
-                _iterator->element =
-                    _iterator->hash->buckets[_iterator->bucketIt]->head;
-
-                if (_iterator->element != NULL)
-                {
-                    result = _iterator->element->object;
-                    _iterator->element = _iterator->element->next;
-                }
-            }
-            // else fail and do nothing, result is already NULL
+            _iterator->slot++;
         }
-        // else success
     }
 
     return result;
@@ -21,7 +21,8 @@
 
 #include "dcDefines.h"
 
-#define DEFAULT_HASH_CAPACITY 19
+// the slot count a hash starts with, at least the widest probe group
+#define DEFAULT_HASH_CAPACITY 16
 
 struct dcHashIterator_t;
 
@@ -67,23 +68,47 @@ REGISTER_FUNCTION(dcHashElement_registerNode);
 // dcHash //
 ////////////
 
-typedef uint16_t dcHashCapacityType;
+typedef uint32_t dcHashCapacityType;
 
 /**
- * A hash container
+ * A slot in a dcHash. The key's hash is kept beside the element so a
+ * probe only follows the element pointer when the hashes match
+ */
+struct dcHashSlot_t
+{
+    dcHashType hash;
+    struct dcNode_t *element;
+};
+
+typedef struct dcHashSlot_t dcHashSlot;
+
+/**
+ * A hash container, using open addressing
  */
 struct dcHash_t
 {
     /**
-     * The buckets. An dynamic array of Lists
+     * One control byte per slot: empty, deleted, or 7 bits of the slot's
+     * hash. The first group of bytes is repeated at the end, so a group
+     * can be read from any slot without wrapping
+     */
+    uint8_t *controls;
+
+    /**
+     * The slots, NULL until the first set
      */
-    struct dcList_t **buckets;
+    dcHashSlot *slots;
 
     /**
-     * The capacity, or bucket count
+     * The slot count, a power of two, or 0 before the first set
      */
     dcHashCapacityType capacity;
 
+    /**
+     * The number of empty slots that can be filled before a rehash
+     */
+    dcHashCapacityType growthLeft;
+
     /**
      * The number of elements in the hash
      */
@@ -109,8 +134,8 @@ dcHash *dcHash_create(void);
 struct dcNode_t *dcHash_createNode(void);
 
 /**
- * Allocates a dcHash with given bucket
- * \param _bucketSize The bucket size
+ * Allocates a dcHash with room for a number of elements
+ * \param _capacity The number of elements to make room for
  * \return A newly allocated dcHash
  */
 dcHash *dcHash_createWithCapacity(dcHashCapacityType _capacity);
@@ -310,14 +335,9 @@ struct dcHashIterator_t
     const dcHash *hash;
 
     /**
-     * The current bucket
-     */
-    dcHashCapacityType bucketIt;
-
-    /**
-     * A list iterator for the current bucket
+     * The next slot to look at
      */
-    struct dcListElement_t *element;
+    dcHashCapacityType slot;
 };
 
 typedef struct dcHashIterator_t dcHashIterator;
@@ -144,6 +144,9 @@ static void *evaluateFileSynchronized(void *_argument)
 dcNode *dcFileEvaluator_evaluateFileWithExceptionCatch(const char *_fileName,
                                                        bool _handleException)
 {
+    // whatever is evaluated might need any class
+    dcSystem_initializeDeferredClasses();
+
     EvaluateFileArguments arguments = {0};
     arguments.fileName = _fileName;
     arguments.handleException = _handleException;
@@ -123,6 +123,9 @@ dcNode *dcStringEvaluator_evalString(const char *_inputString,
                                      const char *_fileName,
                                      dcStringEvaluator_evalFlag _flags)
 {
+    // whatever is evaluated might need any class
+    dcSystem_initializeDeferredClasses();
+
     EvalArguments arguments = {0};
     arguments.inputString = _inputString;
     arguments.fileName = _fileName;
@@ -28,6 +28,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <stdatomic.h>
 
 #include "CompiledTaffyVersion.h"
 
@@ -79,6 +80,18 @@
 
 static dcSystem *sSystem = NULL;
 
+//
+// true after a minimal bootstrap, until the classes it didn't initialize are
+// initialized. it's read without the lock, so the release store after
+// initializing pairs with the acquire loads, making the classes visible
+//
+static atomic_bool sClassesDeferred = false;
+
+static bool classesDeferred(void)
+{
+    return atomic_load_explicit(&sClassesDeferred, memory_order_acquire);
+}
+
 #include "dcArrayClass.h"
 #include "dcBlockClass.h"
 #include "dcClass.h"
@@ -171,6 +184,50 @@ const dcTaffy_getTemplatePointer gTaffyBootstrapClasses[] =
     NULL
 };
 
+//
+// The bootstrap classes that the parser and dcFlatArithmetic need, in
+// bootstrap order. A minimal bootstrap initializes only these, leaving the
+// others until something is evaluated
+//
+static const dcTaffy_getTemplatePointer sParserClasses[] =
+{
+    &dcObjectClass_getTemplate,
+    &dcYesClass_getTemplate,
+    &dcNoClass_getTemplate,
+    &dcProcedureClass_getTemplate,
+    &dcFunctionClass_getTemplate,
+    &dcEquationClass_getTemplate,
+    &dcBlockClass_getTemplate,
+    &dcNilClass_getTemplate,
+    &dcStringClass_getTemplate,
+    &dcKernelClass_getTemplate,
+    &dcSymbolClass_getTemplate,
+    &dcNumberClass_getTemplate,
+    &dcMainClass_getTemplate,
+    NULL
+};
+
+static bool isParserClass(const dcClassTemplate *_classTemplate)
+{
+    const dcTaffy_getTemplatePointer *finger;
+
+    for (finger = sParserClasses; *finger != NULL; finger++)
+    {
+        if ((*finger)() == _classTemplate)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool isInitialized(const dcClassTemplate *_classTemplate)
+{
+    return (! classesDeferred()
+            || isParserClass(_classTemplate));
+}
+
 //
 // The constructors
 //
@@ -232,6 +289,85 @@ void dcSystem_setFinal(const char *_className, bool _yesno)
     }
 }
 
+// evaluate the classes that the runtime itself is written with
+static void initializeRuntimeClasses(void)
+{
+    // TODO: find better place for these
+    assert(dcStringEvaluator_evalString(__compiledThreader,
+                                        "CompiledThreader.c",
+                                        NO_STRING_EVALUATOR_FLAGS)
+           != NULL);
+    assert(dcStringEvaluator_evalString(__compiledReentrantMutex,
+                                        "CompiledReentrantMutex.c",
+                                        NO_STRING_EVALUATOR_FLAGS)
+           != NULL);
+
+    sSystem->abortExceptionClassTemplate =
+        dcClassManager_getClassTemplate
+        ("org.taffy.core.exception.AbortException",
+         NULL,
+         NULL,
+         NULL);
+}
+
+// special: convert Number and ComplexNumber to final. There's a limitation
+// now to Taffy such that if you have a class that is defined in both .c
+// and .ty files, it cannot be final, so this waits until they're initialized
+static void finalizeClasses(void)
+{
+    dcSystem_setFinal("org.taffy.core.maths.Number", true);
+    dcSystem_setFinal("org.taffy.core.maths.ComplexNumber", true);
+}
+
+static void *initializeDeferredClasses(void *_argument)
+{
+    const dcTaffy_getTemplatePointer *finger;
+
+    for (finger = gTaffyBootstrapClasses; *finger != NULL; finger++)
+    {
+        dcClassTemplate *classTemplate = (*finger)();
+
+        if (! isParserClass(classTemplate)
+            && classTemplate->cTemplate != NULL
+            && classTemplate->cTemplate->initializer != NULL)
+        {
+            classTemplate->cTemplate->initializer();
+        }
+    }
+
+    initializeRuntimeClasses();
+    finalizeClasses();
+    return NULL;
+}
+
+void dcSystem_initializeDeferredClasses(void)
+{
+    if (sSystem == NULL
+        || sSystem->bootstrap
+        || ! classesDeferred())
+    {
+        return;
+    }
+
+    // the lock is recursive, and initializing a class evaluates strings,
+    // which come back here
+    dcMutex_lock(sSystem->deferredClassesMutex);
+
+    if (classesDeferred()
+        && ! sSystem->initializingDeferredClasses)
+    {
+        sSystem->initializingDeferredClasses = true;
+        dcNodeEvaluator_synchronizeFunctionCall
+            (dcSystem_getCurrentNodeEvaluator(),
+             &initializeDeferredClasses,
+             NULL);
+        sSystem->initializingDeferredClasses = false;
+        atomic_store_explicit(&sClassesDeferred, false, memory_order_release);
+    }
+
+    dcMutex_unlock(sSystem->deferredClassesMutex);
+}
+
 static void *runSynchronizedCreationTasks(void *_argument)
 {
     dcSystem *result = sSystem;
@@ -279,12 +415,19 @@ static void *runSynchronizedCreationTasks(void *_argument)
                == TAFFY_SUCCESS);
     }
 
-    // initialize them
+    // initialize them, or for a minimal bootstrap, only the ones the parser
+    // needs
+    atomic_store_explicit(&sClassesDeferred,
+                          (dcTaffyCommandLineArguments_getMinimalBootstrap
+                           (arguments)),
+                          memory_order_release);
+
     for (finger = gTaffyBootstrapClasses; *finger != NULL; finger++)
     {
         dcClassTemplate *classTemplate = (*finger)();
 
-        if (classTemplate->cTemplate != NULL
+        if (isInitialized(classTemplate)
+            && classTemplate->cTemplate != NULL
             && classTemplate->cTemplate->initializer != NULL)
         {
             classTemplate->cTemplate->initializer();
@@ -317,22 +460,10 @@ static void *runSynchronizedCreationTasks(void *_argument)
         // /sanity
     }
 
-    // TODO: find better place for these
-    assert(dcStringEvaluator_evalString(__compiledThreader,
-                                        "CompiledThreader.c",
-                                        NO_STRING_EVALUATOR_FLAGS)
-           != NULL);
-    assert(dcStringEvaluator_evalString(__compiledReentrantMutex,
-                                        "CompiledReentrantMutex.c",
-                                        NO_STRING_EVALUATOR_FLAGS)
-           != NULL);
-
-    sSystem->abortExceptionClassTemplate =
-        dcClassManager_getClassTemplate
-        ("org.taffy.core.exception.AbortException",
-         NULL,
-         NULL,
-         NULL);
+    if (! classesDeferred())
+    {
+        initializeRuntimeClasses();
+    }
 
     dcFlatArithmetic_initialize();
 
@@ -409,11 +540,10 @@ static void *runSynchronizedCreationTasks(void *_argument)
     }
 #endif // TAFFY_CYGWIN
 
-    // special: convert Number and ComplexNumber to final. There's a limitation
-    // now to Taffy such that if you have a class that is defined in both .c
-    // and .ty files, it cannot be final
-    dcSystem_setFinal("org.taffy.core.maths.Number", true);
-    dcSystem_setFinal("org.taffy.core.maths.ComplexNumber", true);
+    if (! classesDeferred())
+    {
+        finalizeClasses();
+    }
 
     dcGarbageCollector_logState();
     return result;
@@ -444,6 +574,7 @@ dcSystem *dcSystem_createWithArguments(dcCommandLineArguments *_arguments)
     sSystem->threads = dcList_create();
     sSystem->evaluators = dcHash_create();
     dcMutex_initialize();
+    sSystem->deferredClassesMutex = dcMutex_create(true);
     dcStringManager_create();
 
     srand((unsigned int)time(0));
@@ -652,8 +783,9 @@ void dcSystem_free(void)
     {
         const dcClassTemplate *that = (*finger)();
 
-        // call the deinitializer //
-        if (that->cTemplate != NULL
+        // call the deinitializer, if it was initialized //
+        if (isInitialized(that)
+            && that->cTemplate != NULL
             && that->cTemplate->deinitializer != NULL)
         {
             that->cTemplate->deinitializer();
@@ -698,6 +830,7 @@ void dcSystem_free(void)
     dcCondition_free(&sSystem->threadCondition);
     dcMutex_free(&sSystem->upMutex);
     dcCondition_free(&sSystem->upCondition);
+    dcMutex_free(&sSystem->deferredClassesMutex);
 
 #ifndef TAFFY_WINDOWS
     // dlclose each handle
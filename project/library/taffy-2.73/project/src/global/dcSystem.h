@@ -53,6 +53,10 @@ struct dcSystem_t
     // true during bootstrapping, false otherwise
     bool bootstrap;
 
+    // true while initializing the classes a minimal bootstrap deferred
+    bool initializingDeferredClasses;
+    struct dcMutex_t *deferredClassesMutex;
+
     struct dcClassTemplate_t *abortExceptionClassTemplate;
 
     // this hash maps dcNode(dcUnsignedInt) => dcNode(dcFilePackageData)
@@ -78,6 +82,9 @@ dcSystem *dcSystem_createWithArguments
     (struct dcCommandLineArguments_t *_arguments);
 
 void dcSystem_free(void);
+
+// after a minimal bootstrap, initialize the classes it skipped //
+void dcSystem_initializeDeferredClasses(void);
 void dcSystem_mark(void);
 
 void dcSystem_garbageCollectorIsUp(void);
@@ -68,6 +68,9 @@ dcCommandLineArguments *dcTaffyCommandLineArguments_parseAndCreateWithFailure
     dcCommandLineArguments_registerArguments(arguments,
                                              NULL,
                                              "--set-max-future-threads");
+    dcCommandLineArguments_registerArguments(arguments,
+                                             NULL,
+                                             "--minimal-bootstrap");
 
     //
     // <debug> arguments
@@ -161,6 +164,12 @@ int dcTaffyCommandLineArguments_getMaxFutureThreads
                                          -1);
 }
 
+bool dcTaffyCommandLineArguments_getMinimalBootstrap
+    (const dcCommandLineArguments *_arguments)
+{
+    return dcCommandLineArguments_getHit(_arguments, "--minimal-bootstrap");
+}
+
 bool dcTaffyCommandLineArguments_getDebug
     (const dcCommandLineArguments *_arguments)
 {
@@ -107,4 +107,8 @@ bool dcTaffyCommandLineArguments_displayGarbageCollectorStatistics
 int dcTaffyCommandLineArguments_getMaxFutureThreads
     (const struct dcCommandLineArguments_t *_arguments);
 
+// initialize only what the parser needs, and the rest when it's needed
+bool dcTaffyCommandLineArguments_getMinimalBootstrap
+    (const struct dcCommandLineArguments_t *_arguments);
+
 #endif
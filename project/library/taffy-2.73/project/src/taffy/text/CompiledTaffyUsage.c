@@ -28,5 +28,6 @@ const char *__compiledTaffyUsage =    "Usage: taffy file(s) [options]\n"
     "                              $ taffy -c \"[1, 2, 3, 4] size\"\n"
     "                              ==> 4\n"
     "    --set-max-future-threads  Set the max number of future threads (default 10)\n"
+    "    --minimal-bootstrap       Initialize only what parsing needs at first, and the rest when it's needed\n"
     "    -h or --help              Display this help\n"
 ;
\ No newline at end of file
@@ -11,13 +11,40 @@ except OSError:
         print("Error: Failed to load the ppm library. Please check your library path.")
         quit()
 
+lib.PPM_createContext.restype = c_void_p
+lib.PPM_freeContext.argtypes = [c_void_p]
+lib.PPM_setFont.argtypes = [c_void_p, c_char_p]
+lib.PPM_setColorMode.argtypes = [c_void_p, c_char_p]
+lib.PPM_setPalette.argtypes = [c_void_p, c_char_p]
+lib.PPM_setRandomColors.argtypes = [c_void_p, c_int]
+lib.PPM_renderToBuffer.argtypes = [c_void_p, c_char_p, c_char_p, c_size_t]
+lib.PPM_renderToBuffer.restype = c_long
+lib.PPM_getError.argtypes = [c_void_p]
+lib.PPM_getError.restype = c_char_p
+
 class Ppm(object):
-    def __init__(self):
-        self.app = lib.PPM_new()
+    def __init__(self, font="small", color="alternating", palette="basic", random=True):
         self.encoding = "utf-8"
-        lib.PPM_render.restype = c_char_p
+        self.context = lib.PPM_createContext()
+        self.check(lib.PPM_setFont(self.context, font.encode(self.encoding)))
+        self.check(lib.PPM_setColorMode(self.context, color.encode(self.encoding)))
+        self.check(lib.PPM_setPalette(self.context, palette.encode(self.encoding)))
+        lib.PPM_setRandomColors(self.context, 1 if random else 0)
+
+    def __del__(self):
+        lib.PPM_freeContext(self.context)
+
+    def check(self, result):
+        if result < 0:
+            raise ValueError(lib.PPM_getError(self.context).decode(self.encoding))
+
+        return result
 
     def render(self, text):
         encoded = text.encode(self.encoding)
-        result = lib.PPM_render(self.app, encoded)
-        return result.decode(self.encoding)
+
+        # ask for the length, then render into a buffer that's big enough
+        length = self.check(lib.PPM_renderToBuffer(self.context, encoded, None, 0))
+        result = create_string_buffer(length + 1)
+        self.check(lib.PPM_renderToBuffer(self.context, encoded, result, length + 1))
+        return result.value.decode(self.encoding)
@@ -0,0 +1,309 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "AnsiEncoder.h"
+#include "Color.h"
+
+// bright, distinct colors from the 256 color palette
+static const int s256Colors[] = {196, 208, 226, 118, 46, 48, 51, 39, 21, 93, 201, 198};
+
+// the number of truecolor hues
+static const int sTruecolorCount = 12;
+
+// a channel of 'hue' (0 to 6) at full saturation and value, from 0 to 255
+// 'offset' is 5 for red, 3 for green and 1 for blue
+static long getChannel(double hue, double offset)
+{
+    const double k = std::fmod(offset + hue, 6.0);
+    return std::lround(255 * (1 - std::max(0.0, std::min({k, 4 - k, 1.0}))));
+}
+
+AnsiEncoder::Palette AnsiEncoder::getPalette(const std::string &input)
+{
+    const std::map<std::string, Palette> palettes = {
+        {"none",      PALETTE_NONE},
+        {"basic",     PALETTE_BASIC},
+        {"256",       PALETTE_256},
+        {"truecolor", PALETTE_TRUECOLOR}
+    };
+
+    const auto found = palettes.find(input);
+
+    if (found == palettes.end())
+    {
+        throw std::runtime_error(std::string("Unknown palette: ") + input);
+    }
+
+    return found->second;
+}
+
+AnsiEncoder::AnsiEncoder(Palette palette, bool randomColors)
+    : maxCodeLength_(0),
+      randomColors_(randomColors),
+      engine_(std::random_device()())
+{
+    switch (palette)
+    {
+    case PALETTE_NONE:
+        break;
+
+    case PALETTE_BASIC:
+        for (const Color *color : {&Color::red,
+                                   &Color::green,
+                                   &Color::yellow,
+                                   &Color::blue,
+                                   &Color::magenta,
+                                   &Color::cyan})
+        {
+            palette_.push_back(color->getCode());
+        }
+
+        break;
+
+    case PALETTE_256:
+        for (int color : s256Colors)
+        {
+            palette_.push_back(Color("1", "38;5;" + std::to_string(color)).getCode());
+        }
+
+        break;
+
+    case PALETTE_TRUECOLOR:
+        for (int i = 0; i < sTruecolorCount; i++)
+        {
+            const double hue = 6.0 * i / sTruecolorCount;
+
+            std::ostringstream color;
+            color << "38;2;"
+                  << getChannel(hue, 5) << ";"
+                  << getChannel(hue, 3) << ";"
+                  << getChannel(hue, 1);
+            palette_.push_back(Color("1", color.str()).getCode());
+        }
+
+        break;
+    }
+
+    for (const std::string &code : palette_)
+    {
+        maxCodeLength_ = std::max(maxCodeLength_, code.length());
+        codes_.push_back(&code);
+    }
+
+    shuffle();
+}
+
+AnsiEncoder::~AnsiEncoder()
+{
+}
+
+void AnsiEncoder::shuffle()
+{
+    if (randomColors_)
+    {
+        // start from the palette's order, so a seed always gives the same one
+        for (size_t i = 0; i < palette_.size(); i++)
+        {
+            codes_[i] = &palette_[i];
+        }
+
+        std::shuffle(codes_.begin(), codes_.end(), engine_);
+    }
+}
+
+void AnsiEncoder::setSeed(unsigned long seed)
+{
+    engine_.seed(seed);
+}
+
+size_t AnsiEncoder::getMaxLength(const Lattice &lattice) const
+{
+    return getMaxLength(lattice.getWidth(), lattice.getHeight());
+}
+
+size_t AnsiEncoder::getMaxLength(size_t width, size_t height) const
+{
+    size_t result = width * height + (height > 0 ? height - 1 : 0);
+
+    if (! codes_.empty())
+    {
+        // at worst every element changes color, and every line is reset
+        result += (width * height * maxCodeLength_
+                   + height * Color::end.getCode().length());
+    }
+
+    return result;
+}
+
+size_t AnsiEncoder::getLikelyLength(size_t width, size_t height) const
+{
+    size_t result = width * height + (height > 0 ? height - 1 : 0);
+
+    if (! codes_.empty())
+    {
+        // colors change a few times a line, not every element
+        result += height * (2 * maxCodeLength_ + Color::end.getCode().length());
+    }
+
+    return result;
+}
+
+// appends to a string that has room
+struct StringOutput
+{
+    void write(const char *text, size_t length)
+    {
+        string.append(text, length);
+    }
+
+    void write(char value)
+    {
+        string.push_back(value);
+    }
+
+    std::string &string;
+};
+
+// writes what fits in a buffer, and counts everything
+struct BufferOutput
+{
+    void write(const char *text, size_t count)
+    {
+        if (length < size)
+        {
+            memcpy(buffer + length, text, std::min(count, size - length));
+        }
+
+        length += count;
+    }
+
+    void write(char value)
+    {
+        if (length < size)
+        {
+            buffer[length] = value;
+        }
+
+        length++;
+    }
+
+    char *buffer;
+    size_t size;
+    size_t length;
+};
+
+template <typename Output>
+void AnsiEncoder::encode(const Lattice &lattice, size_t top, size_t height, Output &output) const
+{
+    const std::string &end = Color::end.getCode();
+
+    // the ids of the rows, if they vary
+    std::vector<Lattice::Id> ids(lattice.hasUniformId() || codes_.empty()
+                                 ? 0
+                                 : lattice.width_ * height);
+
+    if (! ids.empty())
+    {
+        lattice.getIds(ids.data(), top, height);
+    }
+
+    for (size_t i = 0; i < height; i++)
+    {
+        const char *row = lattice.getGlyphRow(top + i);
+        const std::string *current = NULL;
+
+        if (codes_.empty())
+        {
+            output.write(row, lattice.width_);
+        }
+        else
+        {
+            for (size_t j = 0; j < lattice.width_; j++)
+            {
+                if (row[j] != ' ')
+                {
+                    const Lattice::Id id = (ids.empty()
+                                            ? lattice.uniformId_
+                                            : ids[i * lattice.width_ + j]);
+                    const std::string *code = codes_[id % codes_.size()];
+
+                    if (code != current)
+                    {
+                        output.write(code->data(), code->length());
+                        current = code;
+                    }
+                }
+
+                output.write(row[j]);
+            }
+        }
+
+        if (current != NULL)
+        {
+            output.write(end.data(), end.length());
+        }
+
+        if (i < height - 1)
+        {
+            output.write('\n');
+        }
+    }
+}
+
+void AnsiEncoder::encode(const Lattice &lattice, std::string &output) const
+{
+    output.clear();
+    output.reserve(getLikelyLength(lattice.width_, lattice.height_));
+
+    StringOutput stringOutput = {output};
+    encode(lattice, 0, lattice.height_, stringOutput);
+}
+
+std::string AnsiEncoder::encode(const Lattice &lattice) const
+{
+    std::string result;
+    encode(lattice, result);
+    return result;
+}
+
+size_t AnsiEncoder::encode(const Lattice &lattice, char *buffer, size_t size) const
+{
+    BufferOutput bufferOutput = {buffer, size, 0};
+    encode(lattice, 0, lattice.height_, bufferOutput);
+    return bufferOutput.length;
+}
+
+void AnsiEncoder::encode(const Lattice &lattice,
+                         size_t top,
+                         size_t height,
+                         std::string &output) const
+{
+    output.clear();
+    output.reserve(getLikelyLength(lattice.width_, height));
+
+    StringOutput stringOutput = {output};
+    encode(lattice, top, height, stringOutput);
+}
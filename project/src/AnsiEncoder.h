@@ -0,0 +1,108 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// An AnsiEncoder turns a Lattice into text, coloring each element by its id
+//
+// A color code is only written when the color changes, and spaces don't
+// change it since their color can't be seen. Each line that has color ends
+// with a reset, so a line never leaks its color into the next
+//
+#ifndef __ANSI_ENCODER_H__
+#define __ANSI_ENCODER_H__
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Lattice.h"
+
+class AnsiEncoder
+{
+public:
+    enum Palette
+    {
+        // no color
+        PALETTE_NONE,
+
+        // the six basic terminal colors
+        PALETTE_BASIC,
+
+        // twelve colors from the 256 color palette
+        PALETTE_256,
+
+        // twelve 24-bit colors, evenly spaced around the color wheel
+        PALETTE_TRUECOLOR
+    };
+
+    // throws std::runtime_error
+    static Palette getPalette(const std::string &input);
+
+    AnsiEncoder(Palette palette, bool randomColors = true);
+    virtual ~AnsiEncoder();
+
+    // can't copy
+    AnsiEncoder(const AnsiEncoder &other) = delete;
+    AnsiEncoder &operator=(const AnsiEncoder &other) = delete;
+
+    // put the colors in a new random order, if they're random
+    void shuffle();
+
+    // make the random orders repeatable
+    void setSeed(unsigned long seed);
+
+    // the most characters 'lattice' can encode to
+    size_t getMaxLength(const Lattice &lattice) const;
+
+    // encode 'lattice' into 'output', replacing what's there
+    void encode(const Lattice &lattice, std::string &output) const;
+    std::string encode(const Lattice &lattice) const;
+
+    // encode only the 'height' rows from 'top', without a newline after
+    // the last one. each line is encoded on its own, so encoding a lattice
+    // a band of rows at a time and joining the bands with newlines gives
+    // the same text as encoding it at once
+    void encode(const Lattice &lattice, size_t top, size_t height, std::string &output) const;
+
+    // encode 'lattice' into 'buffer', writing no more than 'size' characters
+    // and no terminating NUL
+    // returns the length of the whole encoding, so if that's more than
+    // 'size' the output was cut short and a buffer that big is needed
+    size_t encode(const Lattice &lattice, char *buffer, size_t size) const;
+
+protected:
+    template <typename Output>
+    void encode(const Lattice &lattice, size_t top, size_t height, Output &output) const;
+
+    size_t getMaxLength(size_t width, size_t height) const;
+
+    // what a string is reserved for before encoding. it's usually enough,
+    // but the string grows if it isn't
+    size_t getLikelyLength(size_t width, size_t height) const;
+
+    // the palette's codes, and the order they're used in
+    std::vector<std::string> palette_;
+    std::vector<const std::string *> codes_;
+    size_t maxCodeLength_;
+    bool randomColors_;
+
+    // each encoder has its own random numbers
+    std::default_random_engine engine_;
+};
+
+#endif
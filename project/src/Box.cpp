@@ -0,0 +1,552 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Box.h"
+
+// the smallest Rect that holds both 'left' and 'right'
+static Rect bounds(const Rect &left, const Rect &right)
+{
+    const int32_t x = std::min(left.x, right.x);
+    const int32_t y = std::min(left.y, right.y);
+
+    return Rect(x,
+                y,
+                std::max(left.x + left.width, right.x + right.width) - x,
+                std::max(left.y + left.height, right.y + right.height) - y);
+}
+
+Box::Box(std::pmr::memory_resource *resource)
+    : children_(resource),
+      extent_(0, 0, 0, 0),
+      marks_(resource),
+      shiftX_(0),
+      shiftY_(0),
+      width_(0),
+      height_(0),
+      id_(-1),
+      idShift_(0),
+      isGrouped_(false)
+{
+}
+
+Box::Box(const std::vector<std::string> &fancyString, char regular)
+    : extent_(0, 0, 0, 0),
+      shiftX_(0),
+      shiftY_(0),
+      width_(0),
+      height_(0),
+      // the lattice takes the current id
+      id_(Lattice::currentId),
+      idShift_(0),
+      isGrouped_(false)
+{
+    lattice_ = std::make_shared<const Lattice>(fancyString, regular);
+    width_ = lattice_->getWidth();
+    height_ = lattice_->getHeight();
+}
+
+Box::Box(const std::shared_ptr<const Lattice> &lattice,
+         std::pmr::memory_resource *resource)
+    : lattice_(lattice),
+      children_(resource),
+      extent_(0, 0, 0, 0),
+      marks_(resource),
+      shiftX_(0),
+      shiftY_(0),
+      width_(lattice->getWidth()),
+      height_(lattice->getHeight()),
+      // the lattice's own ids are covered by ours when drawn
+      id_(Lattice::currentId++),
+      idShift_(0),
+      isGrouped_(false)
+{
+}
+
+Box::Box(const Box &other)
+    : Box(other, other.getResource())
+{
+}
+
+Box::Box(const Box &other, std::pmr::memory_resource *resource)
+    : lattice_(other.lattice_),
+      children_(other.children_, resource),
+      extent_(other.extent_),
+      marks_(other.marks_, resource),
+      shiftX_(other.shiftX_),
+      shiftY_(other.shiftY_),
+      width_(other.width_),
+      height_(other.height_),
+      id_(other.id_),
+      idShift_(other.idShift_),
+      isGrouped_(other.isGrouped_)
+{
+}
+
+BoxPtr Box::makeLeaf(const std::shared_ptr<const Lattice> &lattice,
+                     std::pmr::memory_resource *resource)
+{
+    BoxPtr result = std::allocate_shared<Box>(std::pmr::polymorphic_allocator<Box>(resource),
+                                              resource);
+    result->lattice_ = lattice;
+    result->width_ = lattice->getWidth();
+    result->height_ = lattice->getHeight();
+    return result;
+}
+
+BoxPtr Box::makeRule(const Box &piece, size_t width, bool newIds)
+{
+    // each copy leaves out its first column, and covers the last column of
+    // the one before
+    const int32_t step = (int32_t)piece.getWidth() - 2;
+
+    if (! piece.isLeaf() || step <= 0)
+    {
+        throw std::invalid_argument("Box::makeRule");
+    }
+
+    const Lattice &tile = *piece.lattice_;
+
+    const size_t count = (width == 0
+                          ? 1
+                          : (width - 1) / step + 1);
+    std::pmr::memory_resource *resource = piece.getResource();
+    std::shared_ptr<Lattice> rule =
+        std::allocate_shared<Lattice>(std::pmr::polymorphic_allocator<Lattice>(resource),
+                                      count * step + 1,
+                                      std::max(tile.getHeight(), (size_t)1),
+                                      resource);
+
+    rule->stamp(tile, 0, 0, 1, 0, 0, 1, piece.id_);
+
+    if (newIds)
+    {
+        rule->stamp(tile, step, 0, count - 1, step, 0, 1, Lattice::currentId, 1);
+
+        // the last copy is followed by a new id too
+        Lattice::currentId += count;
+    }
+    else
+    {
+        rule->stamp(tile, step, 0, count - 1, step, 0, 1, piece.id_);
+    }
+
+    return makeLeaf(rule, resource);
+}
+
+BoxPtr Box::makeBracket(const Box &cap, const Box &pipe, size_t height, uint32_t pipeX)
+{
+    const size_t capHeight = cap.getHeight();
+    const size_t pipeHeight = pipe.getHeight();
+
+    if (! cap.isLeaf() || ! pipe.isLeaf() || pipeHeight == 0)
+    {
+        throw std::invalid_argument("Box::makeBracket");
+    }
+
+    const size_t count = (capHeight > height
+                          ? 0
+                          : (height - capHeight) / pipeHeight + 1);
+    std::pmr::memory_resource *resource = cap.getResource();
+    std::shared_ptr<Lattice> bracket =
+        std::allocate_shared<Lattice>(std::pmr::polymorphic_allocator<Lattice>(resource),
+                                      (count == 0
+                                       ? cap.getWidth()
+                                       : std::max(cap.getWidth(), pipeX + pipe.getWidth())),
+                                      2 * capHeight + count * pipeHeight,
+                                      resource);
+
+    bracket->stamp(*cap.lattice_, 0, 0, 1, 0, 0, 0, cap.id_);
+    bracket->stamp(*pipe.lattice_, pipeX, capHeight, count, 0, pipeHeight, 0, pipe.id_);
+    bracket->stamp(*cap.lattice_, 0, capHeight + count * pipeHeight, 1, 0, 0, 0, cap.id_);
+
+    return makeLeaf(bracket, resource);
+}
+
+Box::~Box()
+{
+}
+
+std::pmr::memory_resource *Box::getResource() const
+{
+    return children_.get_allocator().resource();
+}
+
+bool Box::isLeaf() const
+{
+    return lattice_ != nullptr;
+}
+
+void Box::makeComposite()
+{
+    if (! isLeaf())
+    {
+        return;
+    }
+
+    BoxPtr leaf = std::allocate_shared<Box>(children_.get_allocator(), *this);
+    Placement placement = {leaf, 0, 0, 0, id_, false};
+
+    lattice_.reset();
+    idShift_ = 0;
+    children_.push_back(placement);
+    extent_ = Rect(0, 0, width_, height_);
+}
+
+Position Box::place(const BoxPtr &other, int x, int y, int32_t clipLeft)
+{
+    makeComposite();
+
+    clipLeft = std::min(clipLeft, (int32_t)other->getWidth());
+    const size_t width = other->getWidth() - clipLeft;
+
+    if (x < 0)
+    {
+        prependColumns(-x);
+        x = 0;
+    }
+
+    if (y < 0)
+    {
+        prependRows(-y);
+        y = 0;
+    }
+
+    size_t endX = (size_t)(x + width);
+
+    if (endX >= getWidth())
+    {
+        appendColumns(endX - getWidth());
+    }
+
+    size_t endY = (size_t)(y + other->getHeight());
+
+    if (endY >= getHeight())
+    {
+        appendRows(endY - getHeight());
+    }
+
+    Placement placement = {other,
+                           x - shiftX_,
+                           y - shiftY_,
+                           clipLeft,
+                           (other->isLeaf()
+                            ? other->id_
+                            : -1),
+                           false};
+    const Rect area(placement.x, placement.y, width, other->getHeight());
+
+    if (! area.isEmpty())
+    {
+        if (children_.empty())
+        {
+            extent_ = area;
+        }
+        else
+        {
+            // only a box that lands on an earlier one has to blank its
+            // area before drawing, everything else draws onto blanks
+            placement.overlaps = extent_.intersects(area);
+            extent_ = bounds(extent_, area);
+        }
+    }
+
+    children_.push_back(placement);
+
+    // we aren't grouped anymore, nor do we share one id
+    isGrouped_ = false;
+    id_ = -1;
+
+    return Position(x, y);
+}
+
+Position Box::paste(const BoxPtr &other, int x, int y)
+{
+    return place(other, x, y, 0);
+}
+
+void Box::prependRows(size_t count)
+{
+    makeComposite();
+    shiftY_ += count;
+    height_ += count;
+}
+
+void Box::prependColumns(size_t count)
+{
+    makeComposite();
+
+    if (height_ == 0)
+    {
+        // like a Lattice, an empty box grows a single row
+        appendRows(1);
+    }
+
+    shiftX_ += count;
+    width_ += count;
+}
+
+void Box::appendRows(size_t count)
+{
+    makeComposite();
+    height_ += count;
+}
+
+void Box::appendColumns(size_t count)
+{
+    makeComposite();
+
+    if (height_ == 0)
+    {
+        // like a Lattice, an empty box grows a single row
+        appendRows(1);
+    }
+
+    width_ += count;
+}
+
+Position Box::addToRightMiddle(const BoxPtr &other, int32_t xOffset)
+{
+    return paste(other, getWidth() + xOffset, getHeight() / 2 - other->getHeight() / 2);
+}
+
+Position Box::addToRight(const BoxPtr &other, int32_t xOffset)
+{
+    return paste(other, getWidth() + xOffset, getHeight() - other->getHeight());
+}
+
+Position Box::addToRightSquished(const BoxPtr &other)
+{
+    // overlap by a column, minus the first column of 'other'
+    return place(other, getWidth() - 1, getHeight() / 2 - other->getHeight() / 2, 1);
+}
+
+Position Box::addToLeft(const BoxPtr &other)
+{
+    return paste(other, -other->getWidth(), getHeight() / 2 - other->getHeight() / 2);
+}
+
+Position Box::addToBottom(const BoxPtr &other, uint32_t x)
+{
+    return paste(other, x, getHeight());
+}
+
+Position Box::addToBottomCenter(const BoxPtr &other)
+{
+    return paste(other, getWidth() / 2 - other->getWidth() / 2, getHeight());
+}
+
+Position Box::addToTopRight(const BoxPtr &other)
+{
+    return paste(other, getWidth(), -other->getHeight() + 1);
+}
+
+Box *Box::removeBlankLines()
+{
+    // we need the characters for this, so draw them and become a leaf
+    std::shared_ptr<Lattice> lattice = drawLeaf();
+    lattice->removeBlankLines();
+    setLeaf(lattice);
+
+    return this;
+}
+
+Box *Box::flatten()
+{
+    if (! isLeaf())
+    {
+        setLeaf(drawLeaf());
+    }
+
+    return this;
+}
+
+std::shared_ptr<Lattice> Box::drawLeaf() const
+{
+    std::shared_ptr<Lattice> lattice =
+        std::allocate_shared<Lattice>(children_.get_allocator(),
+                                      width_,
+                                      height_,
+                                      getResource());
+    draw(*lattice, 0, 0, Rect(0, 0, width_, height_), id_);
+    return lattice;
+}
+
+void Box::setLeaf(const std::shared_ptr<const Lattice> &lattice)
+{
+    width_ = lattice->getWidth();
+    height_ = lattice->getHeight();
+    lattice_ = lattice;
+    children_.clear();
+    marks_.clear();
+    extent_ = Rect(0, 0, 0, 0);
+    shiftX_ = 0;
+    shiftY_ = 0;
+
+    // the shift is drawn in
+    idShift_ = 0;
+}
+
+size_t Box::getWidth() const
+{
+    return width_;
+}
+
+size_t Box::getHeight() const
+{
+    return height_;
+}
+
+void Box::engroup(const BoxPtr &left, const BoxPtr &right)
+{
+    addToLeft(left);
+    addToRight(right);
+    isGrouped_ = true;
+}
+
+bool Box::isGrouped() const
+{
+    return isGrouped_;
+}
+
+void Box::mark(const Position &position)
+{
+    if (position.x >= width_ || position.y >= height_)
+    {
+        throw std::out_of_range("Box::mark");
+    }
+
+    marks_.push_back(std::make_pair((int32_t)position.x - shiftX_,
+                                    (int32_t)position.y - shiftY_));
+}
+
+// Add 'other' at every marked position
+void Box::paste(const BoxPtr &other)
+{
+    // go from the bottom right, like a Lattice does
+    std::sort(marks_.begin(),
+              marks_.end(),
+              [](const std::pair<int32_t, int32_t> &left,
+                 const std::pair<int32_t, int32_t> &right) {
+                  return (left.second != right.second
+                          ? left.second > right.second
+                          : left.first > right.first);
+              });
+    marks_.erase(std::unique(marks_.begin(), marks_.end()), marks_.end());
+
+    std::pmr::vector<std::pair<int32_t, int32_t>> marks(marks_.get_allocator());
+    marks.swap(marks_);
+
+    for (const auto &mark : marks)
+    {
+        paste(other, mark.first + shiftX_, mark.second + shiftY_);
+    }
+}
+
+void Box::setNewId()
+{
+    id_ = Lattice::currentId;
+
+    for (Placement &child : children_)
+    {
+        child.id = id_;
+    }
+
+    Lattice::currentId++;
+}
+
+void Box::shiftIds(int count)
+{
+    flatten();
+
+    if (id_ != -1)
+    {
+        id_ += count;
+    }
+
+    idShift_ += count;
+}
+
+void Box::setId(const Box &other)
+{
+    // only a uniform id can be taken
+    if (other.id_ == -1)
+    {
+        return;
+    }
+
+    id_ = other.id_;
+
+    for (Placement &child : children_)
+    {
+        child.id = id_;
+    }
+}
+
+std::unique_ptr<Lattice> Box::draw() const
+{
+    std::unique_ptr<Lattice> result(new Lattice(width_, height_));
+    draw(*result, 0, 0, Rect(0, 0, width_, height_), id_);
+    return result;
+}
+
+std::unique_ptr<Lattice> Box::draw(size_t top, size_t height) const
+{
+    std::unique_ptr<Lattice> result(new Lattice(width_, height));
+    draw(*result, 0, -(int32_t)top, Rect(0, 0, width_, height), id_);
+    return result;
+}
+
+void Box::draw(Lattice &target, int32_t x, int32_t y, const Rect &clip, int id) const
+{
+    if (isLeaf())
+    {
+        target.blit(*lattice_, x, y, clip, id, idShift_);
+        return;
+    }
+
+    for (const Placement &child : children_)
+    {
+        const int32_t left = x + shiftX_ + child.x;
+        const int32_t top = y + shiftY_ + child.y;
+        const Rect area = clip.intersect(Rect(left,
+                                              top,
+                                              child.box->getWidth() - child.clipLeft,
+                                              child.box->getHeight()));
+
+        if (area.isEmpty())
+        {
+            continue;
+        }
+
+        if (child.overlaps)
+        {
+            target.clear(area);
+        }
+
+        child.box->draw(target,
+                        left - child.clipLeft,
+                        top,
+                        area,
+                        (id != -1
+                         ? id
+                         : child.id));
+    }
+}
@@ -0,0 +1,202 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A Box is a node in a layout tree. It has the same geometry as a Lattice,
+// but instead of copying its children's characters it only records where
+// they go. Once the layout is done, draw() blits every glyph exactly once
+// into a single Lattice.
+//
+// Children are shared, not copied, so a Box must not change after it has
+// been added to another one. Its id is the exception, since that's
+// captured when it's added.
+//
+// Everything a Box allocates comes from the memory resource it's made
+// with, so a whole layout can live in one arena.
+//
+#ifndef __BOX_H__
+#define __BOX_H__
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Lattice.h"
+
+class Box;
+
+using BoxPtr = std::shared_ptr<Box>;
+
+class Box
+{
+public:
+    // constructing
+    Box(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+    Box(const std::vector<std::string> &fancyString, char regular);
+
+    // a leaf that shares 'lattice', under an id of its own
+    Box(const std::shared_ptr<const Lattice> &lattice,
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    // a copy uses the same memory resource as 'other', unless it's given one
+    Box(const Box &other);
+    Box(const Box &other, std::pmr::memory_resource *resource);
+
+    //
+    // rules and brackets are drawn in one pass into a leaf of their own,
+    // whose elements keep the ids of the pieces they came from. each piece
+    // must be a leaf, and the result uses the same memory resource
+    //
+
+    // copies of 'piece', squished together like addToRightSquished() does,
+    // until they're wider than 'width'. with 'newIds', each copy after the
+    // first takes a new id, as if setNewId() were called after adding each
+    // throws std::invalid_argument if 'piece' is too narrow to squish
+    static BoxPtr makeRule(const Box &piece, size_t width, bool newIds);
+
+    // 'cap', then copies of 'pipe', 'pipeX' columns in, until they're taller
+    // than 'height', then 'cap' again, added like addToBottom() does
+    // throws std::invalid_argument if 'pipe' has no height
+    static BoxPtr makeBracket(const Box &cap,
+                              const Box &pipe,
+                              size_t height,
+                              uint32_t pipeX);
+
+    // destructing
+    virtual ~Box();
+
+    // mutability
+    Position addToLeft(const BoxPtr &other);
+    Position addToRight(const BoxPtr &other, int32_t xOffset = 0);
+    Position addToRightMiddle(const BoxPtr &other, int32_t xOffset = 0);
+    Position addToRightSquished(const BoxPtr &other);
+    Position addToBottom(const BoxPtr &other, uint32_t x = 0);
+    Position addToBottomCenter(const BoxPtr &other);
+    Position addToTopRight(const BoxPtr &other);
+    void prependRows(size_t count);
+    void prependColumns(size_t count);
+    void appendRows(size_t count);
+    void appendColumns(size_t count);
+    Box *removeBlankLines();
+
+    // draw the children into a leaf of our own, so we no longer need them,
+    // nor the memory resource they came from
+    Box *flatten();
+
+    // dimensions
+    size_t getWidth() const;
+    size_t getHeight() const;
+
+    // grouping
+    void engroup(const BoxPtr &left, const BoxPtr &right);
+    bool isGrouped() const;
+
+    // marking and pasting
+    void mark(const Position &position);
+
+    // add 'other' at the marked positions
+    void paste(const BoxPtr &other);
+
+    // add 'other' at position (x, y)
+    Position paste(const BoxPtr &other, int x, int y);
+
+    // id setting
+    void setId(const Box &other);
+    void setNewId();
+
+    // add 'count' to every id, flattening first since the children are
+    // shared
+    void shiftIds(int count);
+
+    // output
+    std::unique_ptr<Lattice> draw() const;
+
+    // draw only the 'height' rows from 'top', into a lattice that's as wide
+    // as the box and 'height' tall
+    std::unique_ptr<Lattice> draw(size_t top, size_t height) const;
+
+protected:
+    struct Placement
+    {
+        BoxPtr box;
+
+        // where the box goes, before shifting
+        int32_t x;
+        int32_t y;
+
+        // the number of the box's leftmost columns that are hidden
+        int32_t clipLeft;
+
+        // the id given to everything in the box, or -1 to keep its own
+        int id;
+
+        // whether the box lands on any of the ones before it
+        bool overlaps;
+    };
+
+    Position place(const BoxPtr &other, int x, int y, int32_t clipLeft);
+
+    // draw into 'target' with our top left at (x, y), touching only 'clip'
+    void draw(Lattice &target, int32_t x, int32_t y, const Rect &clip, int id) const;
+
+    // turn a leaf into a Box that holds the leaf as its only child
+    void makeComposite();
+
+    // a leaf of 'lattice', whose elements keep their ids
+    static BoxPtr makeLeaf(const std::shared_ptr<const Lattice> &lattice,
+                           std::pmr::memory_resource *resource);
+
+    // draw everything into a new lattice, and become a leaf of one
+    std::shared_ptr<Lattice> drawLeaf() const;
+    void setLeaf(const std::shared_ptr<const Lattice> &lattice);
+
+    bool isLeaf() const;
+
+    std::pmr::memory_resource *getResource() const;
+
+    // a leaf holds its characters
+    std::shared_ptr<const Lattice> lattice_;
+
+    // everything else holds children
+    std::pmr::vector<Placement> children_;
+
+    // the bounds of the children, before shifting
+    Rect extent_;
+
+    // marked positions, before shifting
+    std::pmr::vector<std::pair<int32_t, int32_t>> marks_;
+
+    // how far prepending has pushed everything right and down
+    int32_t shiftX_;
+    int32_t shiftY_;
+
+    size_t width_;
+    size_t height_;
+
+    // the id shared by everything in the box, or -1 if it varies
+    int id_;
+
+    // what's added to the ids of a leaf's lattice when it's drawn
+    int idShift_;
+
+    bool isGrouped_;
+};
+
+#endif
@@ -18,11 +18,17 @@
 
 #include "CommandLineArguments.h"
 
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 #include <regex>
+#include <thread>
 
 CommandLineArguments::CommandLineArguments()
+    : randomMode_(true),
+      profile_(false),
+      watch_(false),
+      jobs_(1)
 {
 }
 
@@ -44,6 +50,10 @@ void CommandLineArguments::showHelpLine()
 void CommandLineArguments::showUsage()
 {
     std::cout << "Usage: ppm [options] input\n"
+              << "       ppm [options] --batch file\n"
+              << "       ppm [options] --serve socket\n"
+              << "       ppm [options] --connect socket input\n"
+              << "       ppm [options] --watch\n"
               << "\n"
               << "input is a string, like: \"sin(x) + e^2\"\n"
               << "\n"
@@ -51,14 +61,36 @@ void CommandLineArguments::showUsage()
               << "\n"
               << "--font       Specify font. small is the default. Options:\n"
               << "               banner big ivrit small smscript\n"
+              << "               or the name of an flf file in fonts/\n"
               << "\n"
               << "--color      Specify color mode. alternating is the default. Options:\n"
               << "               none         no color\n"
               << "               alternating  each character gets a new color\n"
               << "               grouped      character groups share a color\n"
               << "\n"
+              << "--palette    Specify the colors to use. basic is the default. Options:\n"
+              << "               basic        the six basic terminal colors\n"
+              << "               256          colors from the 256 color palette\n"
+              << "               truecolor    24-bit colors\n"
+              << "\n"
               << "--no-random  Do not use random colors. Random colors are enabled by default.\n"
               << "\n"
+              << "--batch      Render each line of a file, or of stdin if the file is -.\n"
+              << "               The results are separated by an empty line.\n"
+              << "\n"
+              << "--jobs       The number of threads that render a batch. 1 is the default,\n"
+              << "               0 uses one per core.\n"
+              << "\n"
+              << "--serve      Keep running, and render what clients send to the Unix\n"
+              << "               domain socket at the given path.\n"
+              << "\n"
+              << "--connect    Have the server at the given socket path render the input.\n"
+              << "\n"
+              << "--watch      Read new versions of the input from stdin, a line each, like\n"
+              << "               from an editor, and redraw only the rows that change.\n"
+              << "\n"
+              << "--profile    Write how long each phase of rendering took to stderr.\n"
+              << "\n"
               << "--input   The input to render (default argument)\n";
 }
 
@@ -70,7 +102,11 @@ bool CommandLineArguments::parse(int argc, char **argv)
     // the default color
     colorMode_ = "alternating";
 
+    // the default palette
+    palette_ = "basic";
+
     bool noRandom = false;
+    std::string jobs = "1";
 
     if (argc < 2)
     {
@@ -84,11 +120,18 @@ bool CommandLineArguments::parse(int argc, char **argv)
         {"--input",  &text_},
         {"--font",   &fontType_},
         {"--color",  &colorMode_},
+        {"--palette", &palette_},
+        {"--batch",  &batchFile_},
+        {"--serve",  &servePath_},
+        {"--connect", &connectPath_},
+        {"--jobs",   &jobs},
         {"--help",   NULL}
     };
 
     const std::unordered_map<std::string, bool *> soleArguments = {
-        {"--no-random", &noRandom}
+        {"--no-random", &noRandom},
+        {"--profile",   &profile_},
+        {"--watch",     &watch_}
     };
 
     // parse the arguments
@@ -133,6 +176,25 @@ bool CommandLineArguments::parse(int argc, char **argv)
     // convert local representation to member
     randomMode_ = ! noRandom;
 
+    if (result)
+    {
+        if (! std::regex_match(jobs, std::regex("[0-9]{1,4}")))
+        {
+            std::cout << "Error: --jobs needs a number, not: " << jobs << "\n";
+            showHelpLine();
+            result = false;
+        }
+        else
+        {
+            jobs_ = std::stoul(jobs);
+
+            if (jobs_ == 0)
+            {
+                jobs_ = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+        }
+    }
+
     // remove trailing whitespace
     while (text_.length() > 0 && text_[text_.length() - 1] == ' ')
     {
@@ -145,7 +207,21 @@ bool CommandLineArguments::parse(int argc, char **argv)
         text_ = text_.substr(1, text_.length());
     }
 
-    if (text_ == "" && result)
+    if (isClient() && (isServe() || isBatch()) && result)
+    {
+        std::cout << "Error: --connect can't be used with --serve or --batch\n";
+        showHelpLine();
+        result = false;
+    }
+
+    if (isWatch() && (isServe() || isBatch() || isClient()) && result)
+    {
+        std::cout << "Error: --watch can't be used with --serve, --batch or --connect\n";
+        showHelpLine();
+        result = false;
+    }
+
+    if (text_ == "" && ! isBatch() && ! isServe() && ! isWatch() && result)
     {
         // no error has been given yet since result is true
         std::cout << "Error: input must be provided\n";
@@ -166,6 +242,11 @@ const std::string &CommandLineArguments::getColorMode() const
     return colorMode_;
 }
 
+const std::string &CommandLineArguments::getPalette() const
+{
+    return palette_;
+}
+
 const std::string &CommandLineArguments::getText() const
 {
     return text_;
@@ -175,3 +256,48 @@ bool CommandLineArguments::useRandomColors() const
 {
     return randomMode_;
 }
+
+bool CommandLineArguments::isBatch() const
+{
+    return batchFile_ != "";
+}
+
+const std::string &CommandLineArguments::getBatchFile() const
+{
+    return batchFile_;
+}
+
+bool CommandLineArguments::isServe() const
+{
+    return servePath_ != "";
+}
+
+const std::string &CommandLineArguments::getServePath() const
+{
+    return servePath_;
+}
+
+bool CommandLineArguments::isClient() const
+{
+    return connectPath_ != "";
+}
+
+const std::string &CommandLineArguments::getConnectPath() const
+{
+    return connectPath_;
+}
+
+unsigned int CommandLineArguments::getJobs() const
+{
+    return jobs_;
+}
+
+bool CommandLineArguments::isWatch() const
+{
+    return watch_;
+}
+
+bool CommandLineArguments::isProfile() const
+{
+    return profile_;
+}
@@ -34,16 +34,45 @@ public:
 
     const std::string &getFontType() const;
     const std::string &getColorMode() const;
+    const std::string &getPalette() const;
     const std::string &getText() const;
     bool useRandomColors() const;
 
+    // batch mode reads its input from a file, or from stdin for "-"
+    bool isBatch() const;
+    const std::string &getBatchFile() const;
+
+    // serve mode answers render requests on a Unix domain socket, and
+    // client mode sends its input to one
+    bool isServe() const;
+    const std::string &getServePath() const;
+    bool isClient() const;
+    const std::string &getConnectPath() const;
+
+    // watch mode reads new versions of the input from stdin, a line each,
+    // and redraws only the rows that change
+    bool isWatch() const;
+
+    // the number of threads that render a batch
+    unsigned int getJobs() const;
+
+    // whether to write how long each phase of rendering took to stderr
+    bool isProfile() const;
+
 protected:
     void showHelpLine();
     bool randomMode_;
+    bool profile_;
+    bool watch_;
+    unsigned int jobs_;
 
     std::string fontType_;
     std::string colorMode_;
+    std::string palette_;
     std::string text_;
+    std::string batchFile_;
+    std::string servePath_;
+    std::string connectPath_;
 };
 
 #endif
@@ -16,18 +16,88 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "Font.h"
 
+// the start of a cache file, which is followed by the glyph entries and then
+// the glyph rows
+struct CacheHeader
+{
+    char magic[8];
+
+    // the flf file the cache was made from
+    uint64_t sourceSize;
+    int64_t sourceTime;
+
+    uint32_t maxHeight;
+    uint32_t bufferSize;
+};
+
+static const char sCacheMagic[8] = "ppmflc1";
+
+const char *Glyph::getRow(size_t y) const
+{
+    return rows + y * width;
+}
+
+Font::Font(const std::string &path)
+    : mapped_(NULL),
+      mappedSize_(0),
+      maxHeight_(0)
+{
+    const size_t dot = path.rfind('.');
+    const std::string cachePath = (dot == std::string::npos
+                                   ? path
+                                   : path.substr(0, dot)) + ".flc";
+
+    if (! mapCache(path, cachePath))
+    {
+        std::ifstream infile(path);
+
+        if (! infile)
+        {
+            throw std::runtime_error(std::string("can't open font file: ") + path);
+        }
+
+        parse(infile);
+        writeCache(path, cachePath);
+    }
+}
+
 Font::Font(std::ifstream &infile)
+    : mapped_(NULL),
+      mappedSize_(0),
+      maxHeight_(0)
 {
     parse(infile);
 }
 
+Font::Font(const EmbeddedFont &font)
+    : mapped_(NULL),
+      mappedSize_(0),
+      maxHeight_(font.maxHeight)
+{
+    std::copy(font.entries, font.entries + glyphCount, entries_.begin());
+    setGlyphs(font.rows);
+}
+
 Font::~Font()
 {
+    if (mapped_ != NULL)
+    {
+        munmap(mapped_, mappedSize_);
+    }
 }
 
 uint32_t Font::getMaxHeight() const
@@ -35,16 +105,132 @@ uint32_t Font::getMaxHeight() const
     return maxHeight_;
 }
 
-const StringVector *Font::get(char character)
+const Glyph *Font::get(char character) const
 {
-    const auto found = fonts_.find(character);
-
-    if (found == fonts_.end())
+    if (character < firstCharacter || character > lastCharacter)
     {
         return NULL;
     }
 
-    return &found->second;
+    return &glyphs_[character - firstCharacter];
+}
+
+void Font::setGlyphs(const char *data)
+{
+    for (size_t i = 0; i < glyphCount; i++)
+    {
+        glyphs_[i].rows = data + entries_[i].offset;
+        glyphs_[i].width = entries_[i].width;
+        glyphs_[i].height = entries_[i].height;
+    }
+}
+
+bool Font::mapCache(const std::string &path, const std::string &cachePath)
+{
+    struct stat source;
+    struct stat cache;
+
+    if (stat(path.c_str(), &source) != 0)
+    {
+        return false;
+    }
+
+    int descriptor = open(cachePath.c_str(), O_RDONLY);
+
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    void *mapped = MAP_FAILED;
+
+    if (fstat(descriptor, &cache) == 0
+        && (size_t)cache.st_size >= sizeof(CacheHeader) + sizeof(entries_))
+    {
+        mapped = mmap(NULL, cache.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    }
+
+    // the mapping stays valid after the file is closed
+    close(descriptor);
+
+    if (mapped == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const char *data = (const char *)mapped;
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    memcpy(entries_.data(), data + sizeof(header), sizeof(entries_));
+
+    const size_t rowsStart = sizeof(header) + sizeof(entries_);
+    bool valid = (memcmp(header.magic, sCacheMagic, sizeof(sCacheMagic)) == 0
+                  && header.sourceSize == (uint64_t)source.st_size
+                  && header.sourceTime == (int64_t)source.st_mtime
+                  && rowsStart + header.bufferSize <= (size_t)cache.st_size);
+
+    // make sure every glyph lies in the buffer
+    for (size_t i = 0; valid && i < glyphCount; i++)
+    {
+        valid = ((uint64_t)entries_[i].offset
+                 + (uint64_t)entries_[i].width * entries_[i].height
+                 <= header.bufferSize);
+    }
+
+    if (! valid)
+    {
+        munmap(mapped, cache.st_size);
+        return false;
+    }
+
+    mapped_ = mapped;
+    mappedSize_ = cache.st_size;
+    maxHeight_ = header.maxHeight;
+    setGlyphs(data + rowsStart);
+
+    return true;
+}
+
+void Font::writeCache(const std::string &path, const std::string &cachePath) const
+{
+    struct stat source;
+
+    if (stat(path.c_str(), &source) != 0)
+    {
+        return;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, sCacheMagic, sizeof(sCacheMagic));
+    header.sourceSize = source.st_size;
+    header.sourceTime = source.st_mtime;
+    header.maxHeight = maxHeight_;
+    header.bufferSize = buffer_.size();
+
+    // write to a file of our own and move it into place, so nobody maps a
+    // half-written cache
+    std::ostringstream temporaryPath;
+    temporaryPath << cachePath << "." << getpid();
+
+    std::ofstream outfile(temporaryPath.str(), std::ios::binary);
+
+    if (! outfile)
+    {
+        // probably a read-only directory, so go without
+        return;
+    }
+
+    outfile.write((const char *)&header, sizeof(header));
+    outfile.write((const char *)entries_.data(), sizeof(entries_));
+    outfile.write(buffer_.data(), buffer_.size());
+    outfile.close();
+
+    if (! outfile
+        || std::rename(temporaryPath.str().c_str(), cachePath.c_str()) != 0)
+    {
+        std::remove(temporaryPath.str().c_str());
+    }
 }
 
 void Font::parse(std::ifstream &infile)
@@ -95,10 +281,15 @@ void Font::parse(std::ifstream &infile)
         std::getline(infile, line);
     }
 
+    buffer_.clear();
+
     // parse the ASCII characters
-    for (char key = 32; key <= 126; key++)
+    for (char key = firstCharacter; key <= lastCharacter; key++)
     {
-        std::vector<std::string> font;
+        GlyphEntry &entry = entries_[key - firstCharacter];
+        entry.offset = buffer_.size();
+        entry.width = 0;
+        entry.height = 0;
 
         for (int i = 0; i < height; i++)
         {
@@ -137,12 +328,22 @@ void Font::parse(std::ifstream &infile)
             // in that case
             if (! allSpaces || key == ' ')
             {
-                font.push_back(line);
+                if (entry.height == 0)
+                {
+                    entry.width = line.length();
+                }
+                else if (line.length() != entry.width)
+                {
+                    // the rows are stored at the first one's width
+                    throw std::runtime_error("inconsistent glyph width in font");
+                }
+
+                buffer_.insert(buffer_.end(), line.begin(), line.end());
+                entry.height++;
             }
         }
-
-        fonts_[key] = font;
     }
 
     maxHeight_ = height;
+    setGlyphs(buffer_.data());
 }
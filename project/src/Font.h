@@ -19,34 +19,101 @@
 #ifndef __FONT_H__
 #define __FONT_H__
 
+#include <array>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-typedef std::vector<std::string> StringVector;
-typedef std::unordered_map<char, StringVector> FontMap;
+// A Glyph is one character of a Font, with its rows packed one after another
+struct Glyph
+{
+    // the 'width' characters of row 'y'
+    const char *getRow(size_t y) const;
+
+    const char *rows;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct EmbeddedFont;
 
 // A Font knows how to read and store data from an flf file
+// it doesn't change once it's read, so threads can share it
+//
+// The glyphs of the printable ASCII characters live in one buffer, which is
+// either read from the flf file, mapped from a cache file beside it, or
+// compiled into the program
 class Font
 {
 public:
-    Font(std::ifstream &filename);
+    // the printable ASCII characters, from ' ' to '~'
+    static const char firstCharacter = 32;
+    static const char lastCharacter = 126;
+    static const size_t glyphCount = lastCharacter - firstCharacter + 1;
+
+    // read the flf file at 'path', or its cache if that's up to date
+    // the cache is (re)written when it isn't, if possible
+    Font(const std::string &path);
+
+    // read an flf file
+    Font(std::ifstream &infile);
+
+    // use a font that's compiled in, without copying its glyphs
+    Font(const EmbeddedFont &font);
+
     virtual ~Font();
 
-    // get a character
-    const StringVector *get(char character);
+    // can't copy
+    Font(const Font &other) = delete;
+    Font &operator=(const Font &other) = delete;
+
+    // get a character, or NULL if there isn't one
+    const Glyph *get(char character) const;
 
     uint32_t getMaxHeight() const;
 
+    // where a glyph is in the buffer
+    struct GlyphEntry
+    {
+        uint32_t offset;
+        uint32_t width;
+        uint32_t height;
+    };
+
 protected:
-    // parse a file and fill 'fonts' and 'chompedFonts'
-    void parse(std::ifstream &filename);
+    // parse a file and fill 'entries_' and 'buffer_'
+    void parse(std::ifstream &infile);
+
+    // use the cache at 'cachePath' if it was made from 'path'
+    bool mapCache(const std::string &path, const std::string &cachePath);
+
+    // write the cache for 'path' to 'cachePath', ignoring failures
+    void writeCache(const std::string &path, const std::string &cachePath) const;
+
+    // point the glyphs into 'data'
+    void setGlyphs(const char *data);
+
+    std::array<GlyphEntry, glyphCount> entries_;
+    std::array<Glyph, glyphCount> glyphs_;
 
-    // the fonts
-    FontMap fonts_;
+    // the glyph rows, when read from an flf file
+    std::vector<char> buffer_;
+
+    // the cache file, when it's mapped
+    void *mapped_;
+    size_t mappedSize_;
 
     // the max height of a font
     uint32_t maxHeight_;
 };
 
+// A font that fontCompiler has turned into a table
+struct EmbeddedFont
+{
+    const char *name;
+    uint32_t maxHeight;
+    Font::GlyphEntry entries[Font::glyphCount];
+    const char *rows;
+};
+
 #endif
@@ -17,6 +17,7 @@
 //
 
 #include "FontFactory.h"
+#include "EmbeddedFonts.h"
 
 #include <sstream>
 #include <fstream>
@@ -65,6 +66,16 @@ std::string FontFactory::buildPath(const std::vector<std::string> &path) const
 
 Font *FontFactory::findFont(const std::string &type) const
 {
+    // the fonts we ship are compiled in
+    for (const EmbeddedFont *font : sEmbeddedFonts)
+    {
+        if (type == font->name)
+        {
+            return new Font(*font);
+        }
+    }
+
+    // anything else is read from a file
     std::string fontFile = type + ".flf";
 
     const std::vector<std::string> dirs = {
@@ -81,7 +92,8 @@ Font *FontFactory::findFont(const std::string &type) const
 
         if (infile)
         {
-            result = new Font(infile);
+            infile.close();
+            result = new Font(directory);
             break;
         }
     }
@@ -96,6 +108,7 @@ Font *FontFactory::findFont(const std::string &type) const
 
 Font *FontFactory::createFont(const std::string &type)
 {
+    std::lock_guard<std::mutex> lock(allocatedMutex_);
     auto found = allocated_.find(type);
     Font *result = NULL;
 
@@ -19,6 +19,7 @@
 #ifndef __FONT_FACTORY_H__
 #define __FONT_FACTORY_H__
 
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -26,6 +27,7 @@
 #include "Font.h"
 
 // A singleton factory that creates Font objects from font types
+// it's safe to use from many threads
 class FontFactory
 {
 public:
@@ -47,6 +49,7 @@ protected:
 private:
     // allocated objects
     std::unordered_map<std::string, Font *> allocated_;
+    std::mutex allocatedMutex_;
 };
 
 #endif
@@ -17,13 +17,13 @@
 //
 
 #include <cassert>
+#include <cstring>
 #include <sstream>
-#include <random>
-#include <chrono>
 #include <algorithm>
 
 #include "Lattice.h"
-#include "Color.h"
+#include "AnsiEncoder.h"
+#include "Profile.h"
 
 Position::Position(uint32_t inX, uint32_t inY)
     : x(inX),
@@ -37,91 +37,330 @@ std::ostream &operator<<(std::ostream &out, const Position &position)
     return out;
 }
 
-//
-// Lattice::Element
-//
-Lattice::Element::Element(char fancy, char regular, int id, bool marked)
-    : fancy_(fancy),
-      regular_(regular),
-      id_(id),
-      marked_(marked)
+Rect::Rect(int32_t inX, int32_t inY, int32_t inWidth, int32_t inHeight)
+    : x(inX),
+      y(inY),
+      width(inWidth),
+      height(inHeight)
 {
 }
 
-Lattice::Element::Element(const Element &other)
-    : fancy_(other.fancy_),
-      regular_(other.regular_),
-      id_(other.id_),
-      marked_(other.marked_)
+Rect Rect::intersect(const Rect &other) const
 {
+    const int32_t left = std::max(x, other.x);
+    const int32_t top = std::max(y, other.y);
+    const int32_t right = std::min(x + width, other.x + other.width);
+    const int32_t bottom = std::min(y + height, other.y + other.height);
+
+    return Rect(left, top, std::max(right - left, 0), std::max(bottom - top, 0));
 }
 
-Lattice::Element::Element()
-    : fancy_(' '),
-      regular_(' '),
-      id_(-1),
-      marked_(false)
+bool Rect::intersects(const Rect &other) const
 {
+    return ! intersect(other).isEmpty();
 }
 
-Lattice::Element &Lattice::Element::operator=(const Element &other)
+bool Rect::isEmpty() const
 {
-    fancy_ = other.fancy_;
-    regular_ = other.regular_;
-    id_ = other.id_;
-    marked_ = other.marked_;
-    return *this;
+    return width <= 0 || height <= 0;
+}
+
+// whether the 'width' characters of 'row' are all blank, checked eight
+// at a time
+static bool isBlank(const char *row, size_t width)
+{
+    static const uint64_t blanks = 0x2020202020202020ULL;
+    size_t i = 0;
+
+    for (; i + sizeof(blanks) <= width; i += sizeof(blanks))
+    {
+        uint64_t chunk;
+        std::memcpy(&chunk, row + i, sizeof(chunk));
+
+        if (chunk != blanks)
+        {
+            return false;
+        }
+    }
+
+    for (; i < width; i++)
+    {
+        if (row[i] != ' ')
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 //
 // Lattice
 //
 
-// not thread safe
-unsigned int Lattice::currentId = 0;
+thread_local unsigned int Lattice::currentId = 0;
 
 Lattice::Lattice()
-    : lattice_({}),
+    : uniformId_(-1),
+      stride_(0),
+      originX_(0),
+      originY_(0),
+      width_(0),
+      height_(0),
       isGrouped_(false)
 {
 }
 
+// a copy doesn't share the other's memory resource, since it can outlive it
 Lattice::Lattice(const Lattice &other)
-    : lattice_(other.lattice_),
+    : glyphs_(std::max(other.width_, (size_t)1) * other.height_, ' '),
+      uniformId_(other.uniformId_),
+      stride_(std::max(other.width_, (size_t)1)),
+      originX_(0),
+      originY_(0),
+      width_(other.width_),
+      height_(other.height_),
+      marks_(other.marks_),
       isGrouped_(other.isGrouped_)
 {
+    // copy just the visible part, without the slack
+    for (size_t y = 0; y < height_; y++)
+    {
+        const char *row = other.getGlyphRow(y);
+        std::copy(row, row + width_, getGlyphRow(y));
+    }
+
+    groups_.assign(other.groups_.begin(), other.groups_.end());
 }
 
 Lattice::Lattice(const std::vector<std::string> &fancyString, char regular)
+    : uniformId_(Lattice::currentId),
+      stride_(0),
+      originX_(0),
+      originY_(0),
+      width_(0),
+      height_(fancyString.size()),
+      isGrouped_(false)
 {
+    if (height_ > 0)
+    {
+        width_ = fancyString[0].length();
+    }
+
+    stride_ = std::max(width_, (size_t)1);
+    glyphs_.resize(stride_ * height_, ' ');
+
     for (size_t i = 0; i < fancyString.size(); i++)
     {
-        std::vector<Element> row;
+        // it's an error to have lines of different lengths
+        assert(fancyString[i].length() == width_);
+
+        std::copy(fancyString[i].begin(), fancyString[i].end(), getGlyphRow(i));
+    }
+
+    Lattice::currentId++;
+}
+
+Lattice::Lattice(const char *rows, size_t width, size_t height, char regular)
+    : glyphs_(std::max(width, (size_t)1) * height, ' '),
+      uniformId_(Lattice::currentId),
+      stride_(std::max(width, (size_t)1)),
+      originX_(0),
+      originY_(0),
+      width_(width),
+      height_(height),
+      isGrouped_(false)
+{
+    for (size_t i = 0; i < height_; i++)
+    {
+        std::copy(rows + i * width_, rows + (i + 1) * width_, getGlyphRow(i));
+    }
+
+    Lattice::currentId++;
+}
+
+Lattice::Lattice(size_t width, size_t height, std::pmr::memory_resource *resource)
+    : glyphs_(std::max(width, (size_t)1) * height, ' ', resource),
+      groups_(resource),
+      uniformId_(-1),
+      stride_(std::max(width, (size_t)1)),
+      originX_(0),
+      originY_(0),
+      width_(width),
+      height_(height),
+      isGrouped_(false)
+{
+}
+
+Lattice::~Lattice()
+{
+}
+
+char *Lattice::getGlyphRow(size_t y)
+{
+    return glyphs_.data() + (originY_ + y) * stride_ + originX_;
+}
+
+const char *Lattice::getGlyphRow(size_t y) const
+{
+    return glyphs_.data() + (originY_ + y) * stride_ + originX_;
+}
+
+bool Lattice::hasUniformId() const
+{
+    return groups_.empty();
+}
+
+void Lattice::getIds(Id *ids, size_t top, size_t height) const
+{
+    const Rect rows(0, top, width_, height);
+
+    std::fill(ids, ids + width_ * height, uniformId_);
+
+    // later groups go over the earlier ones
+    for (const Group &group : groups_)
+    {
+        const Rect area = group.area.intersect(rows);
 
-        if (i > 0)
+        for (int32_t y = area.y; y < area.y + area.height; y++)
         {
-            // it's an error to have lines of different lengths
-            assert(fancyString[i].length() == fancyString[i - 1].length());
+            Id *row = ids + (y - top) * width_ + area.x;
+            std::fill(row, row + area.width, group.id);
         }
+    }
+}
+
+Lattice::Id Lattice::getId(size_t x, size_t y) const
+{
+    const Rect element(x, y, 1, 1);
 
-        for (const char &fancy : fancyString[i])
+    for (auto group = groups_.rbegin(); group != groups_.rend(); group++)
+    {
+        if (group->area.intersects(element))
         {
-            row.push_back(Element(fancy, regular, Lattice::currentId, false));
+            return group->id;
         }
+    }
+
+    return uniformId_;
+}
 
-        lattice_.push_back(row);
+void Lattice::fillIds(const Rect &area, Id id)
+{
+    if (area.isEmpty())
+    {
+        return;
     }
 
-    Lattice::currentId++;
+    if (area.width == (int32_t)width_ && area.height == (int32_t)height_)
+    {
+        // it covers everything, so there's one id again
+        groups_.clear();
+        uniformId_ = id;
+        return;
+    }
+
+    if (groups_.empty())
+    {
+        if (uniformId_ == id)
+        {
+            return;
+        }
+    }
+    else
+    {
+        // grow the last group instead, if it lines up with 'area'
+        Rect &last = groups_.back().area;
+
+        if (groups_.back().id == id)
+        {
+            if (last.y == area.y
+                && last.height == area.height
+                && last.x + last.width == area.x)
+            {
+                last.width += area.width;
+                return;
+            }
+            else if (last.x == area.x
+                     && last.width == area.width
+                     && last.y + last.height == area.y)
+            {
+                last.height += area.height;
+                return;
+            }
+        }
+    }
+
+    groups_.push_back(Group{area, id});
 }
 
-Lattice::~Lattice()
+void Lattice::copyIds(const Lattice &other,
+                      int32_t x,
+                      int32_t y,
+                      const Rect &area,
+                      int idShift)
 {
+    fillIds(area, (Id)(other.uniformId_ + idShift));
+
+    for (const Group &group : other.groups_)
+    {
+        fillIds(area.intersect(Rect(group.area.x + x,
+                                    group.area.y + y,
+                                    group.area.width,
+                                    group.area.height)),
+                (Id)(group.id + idShift));
+    }
+}
+
+void Lattice::reserve(size_t left, size_t top, size_t right, size_t bottom)
+{
+    const size_t spareRight = stride_ - originX_ - width_;
+    const size_t rows = (stride_ > 0
+                         ? glyphs_.size() / stride_
+                         : 0);
+    const size_t spareBottom = rows - originY_ - height_;
+
+    if (originX_ >= left
+        && originY_ >= top
+        && spareRight >= right
+        && spareBottom >= bottom
+        && stride_ > 0)
+    {
+        // there's enough room already
+        return;
+    }
+
+    Profile::count(Profile::COUNTER_GROWS);
+
+    // grow geometrically in every direction that's short on room,
+    // so repeated prepends and appends are amortized O(1)
+    const size_t newLeft = (originX_ >= left ? originX_ : std::max(left, width_));
+    const size_t newTop = (originY_ >= top ? originY_ : std::max(top, height_));
+    const size_t newRight = (spareRight >= right ? spareRight : std::max(right, width_));
+    const size_t newBottom = (spareBottom >= bottom ? spareBottom : std::max(bottom, height_));
+    const size_t newStride = std::max(newLeft + width_ + newRight, (size_t)1);
+    const size_t newSize = newStride * (newTop + height_ + newBottom);
+
+    // from the same resource, so the swap below is allowed
+    std::pmr::vector<char> glyphs(newSize, ' ', glyphs_.get_allocator());
+
+    for (size_t y = 0; y < height_; y++)
+    {
+        const char *row = getGlyphRow(y);
+        std::copy(row, row + width_, &glyphs[(newTop + y) * newStride + newLeft]);
+    }
+
+    glyphs_.swap(glyphs);
+    stride_ = newStride;
+    originX_ = newLeft;
+    originY_ = newTop;
 }
 
 // Paste down and to the right
 Position Lattice::paste(const Lattice &other, int x, int y)
 {
+    Profile::count(Profile::COUNTER_BLITS);
+
     if (x < 0)
     {
         prependColumns(-x);
@@ -148,69 +387,188 @@ Position Lattice::paste(const Lattice &other, int x, int y)
         appendRows(endY - getHeight());
     }
 
-    for (size_t row = y; row < y + other.getHeight(); row++)
+    // the rows are contiguous, so copy them whole
+    for (size_t row = 0; row < other.height_; row++)
     {
-        for (size_t column = x; column < x + other.getWidth(); column++)
-        {
-            lattice_.at(row).at(column) = other.lattice_.at(row - y).at(column - x);
-        }
+        const char *source = other.getGlyphRow(row);
+        std::copy(source, source + other.width_, getGlyphRow(y + row) + x);
     }
 
+    copyIds(other, x, y, Rect(x, y, other.width_, other.height_));
+
     // we aren't grouped anymore
     isGrouped_ = false;
 
     return Position(x, y);
 }
 
-void Lattice::prependRows(size_t count)
+void Lattice::blit(const Lattice &other,
+                   int32_t x,
+                   int32_t y,
+                   const Rect &clip,
+                   int id,
+                   int idShift)
 {
-    if (lattice_.size() == 0)
+    Profile::count(Profile::COUNTER_BLITS);
+
+    const Rect area = clip.intersect(Rect(x,
+                                          y,
+                                          (int32_t)other.width_,
+                                          (int32_t)other.height_));
+
+    for (int32_t row = area.y; row < area.y + area.height; row++)
+    {
+        const char *source = other.getGlyphRow(row - y) + area.x - x;
+        std::copy(source, source + area.width, getGlyphRow(row) + area.x);
+    }
+
+    if (id == -1)
     {
-        lattice_.insert(lattice_.begin(), count, {});
+        copyIds(other, x, y, area, idShift);
     }
     else
     {
-        std::vector<Element> row(getWidth());
-        lattice_.insert(lattice_.begin(), count, row);
+        fillIds(area, (Id)id);
+    }
+}
+
+void Lattice::clear(const Rect &rect)
+{
+    // a blank element's id doesn't matter, so leave them be
+    for (int32_t row = rect.y; row < rect.y + rect.height; row++)
+    {
+        char *destination = getGlyphRow(row) + rect.x;
+        std::fill(destination, destination + rect.width, ' ');
+    }
+}
+
+void Lattice::stamp(const Lattice &other,
+                    int32_t x,
+                    int32_t y,
+                    size_t count,
+                    int32_t stepX,
+                    int32_t stepY,
+                    int32_t clipLeft,
+                    int id,
+                    int idStep)
+{
+    const Rect bounds(0, 0, width_, height_);
+    const int32_t width = std::max((int32_t)other.width_ - clipLeft, 0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        blit(other,
+             x - clipLeft,
+             y,
+             bounds.intersect(Rect(x, y, width, other.height_)),
+             (id == -1
+              ? -1
+              : id + (int)i * idStep));
+        x += stepX;
+        y += stepY;
+    }
+}
+
+void Lattice::prependRows(size_t count)
+{
+    reserve(0, count, 0, 0);
+    originY_ -= count;
+    height_ += count;
+
+    for (Position &mark : marks_)
+    {
+        mark.y += count;
+    }
+
+    for (Group &group : groups_)
+    {
+        group.area.y += count;
     }
 }
 
 void Lattice::prependColumns(size_t count)
 {
-    if (lattice_.size() == 0)
+    if (height_ == 0)
     {
-        lattice_.push_back(std::vector<Element>(count));
+        // an empty lattice grows a single row
+        appendRows(1);
     }
-    else
+
+    reserve(count, 0, 0, 0);
+    originX_ -= count;
+    width_ += count;
+
+    for (Position &mark : marks_)
     {
-        for (auto &line : lattice_)
-        {
-            line.insert(line.begin(), count, Element());
-        }
+        mark.x += count;
+    }
+
+    for (Group &group : groups_)
+    {
+        group.area.x += count;
     }
 }
 
 void Lattice::appendRows(size_t count)
 {
-    std::vector<Element> row(getWidth());
-    lattice_.insert(lattice_.end(), count, row);
+    reserve(0, 0, 0, count);
+    height_ += count;
 }
 
 void Lattice::appendColumns(size_t count)
 {
-    if (lattice_.size() == 0)
+    if (height_ == 0)
     {
-        lattice_.push_back(std::vector<Element>(count));
+        // an empty lattice grows a single row
+        appendRows(1);
     }
-    else
+
+    reserve(0, 0, count, 0);
+    width_ += count;
+}
+
+void Lattice::removeLeftColumns(size_t count)
+{
+    count = std::min(count, width_);
+
+    // keep the slack blank
+    for (size_t y = 0; y < height_; y++)
     {
-        size_t width = getWidth();
+        std::fill(getGlyphRow(y), getGlyphRow(y) + count, ' ');
+    }
+
+    originX_ += count;
+    width_ -= count;
+
+    // the marks on the removed columns go with them
+    marks_.erase(std::remove_if(marks_.begin(),
+                                marks_.end(),
+                                [count](const Position &mark) {
+                                    return mark.x < count;
+                                }),
+                 marks_.end());
+
+    for (Position &mark : marks_)
+    {
+        mark.x -= count;
+    }
+
+    // and the groups lose them too
+    auto group = groups_.begin();
 
-        for (auto &line : lattice_)
+    for (auto that = groups_.begin(); that != groups_.end(); that++)
+    {
+        *group = *that;
+        group->area = group->area.intersect(Rect(count, 0, width_, height_));
+        group->area.x -= count;
+
+        if (! group->area.isEmpty())
         {
-            line.resize(width + count);
+            group++;
         }
     }
+
+    groups_.erase(group, groups_.end());
 }
 
 Position Lattice::addToRightMiddle(const Lattice &other, int32_t xOffset)
@@ -231,11 +589,7 @@ Position Lattice::addToBottomRight(const Lattice &other, uint32_t yOffset)
 Position Lattice::addToRightSquished(const Lattice &other)
 {
     Lattice copy = other;
-
-    for (auto &row : copy.lattice_)
-    {
-        row.erase(row.begin());
-    }
+    copy.removeLeftColumns(1);
 
     return paste(copy, getWidth() - 1, getHeight() / 2 - other.getHeight() / 2);
 }
@@ -262,78 +616,33 @@ Position Lattice::addToTopRight(const Lattice &other)
 
 std::string Lattice::convertToString(bool colorize, bool randomColors) const
 {
-    std::vector<const Color *> colors = {
-        &Color::red,
-        &Color::green,
-        &Color::yellow,
-        &Color::blue,
-        &Color::magenta,
-        &Color::cyan
-    };
-
-    if (randomColors)
-    {
-        // obtain a time-based seed:
-        unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-        std::shuffle(colors.begin(), colors.end(), std::default_random_engine(seed));
-    }
-
-    std::ostringstream oss;
-
-    for (size_t i = 0; i < lattice_.size(); i++)
-    {
-        const auto &row = lattice_[i];
-
-        for (const Element &value : row)
-        {
-            if (colorize)
-            {
-                // start the color
-                oss << colors[value.id_ % colors.size()]->getCode();
-            }
-
-            // print the character
-            oss << value.fancy_;
-
-            if (colorize)
-            {
-                // end the color
-                oss << Color::end.getCode();
-            }
-        }
-
-        if (i < lattice_.size() - 1)
-        {
-            oss << "\n";
-        }
-    }
-
-    return oss.str();
+    return AnsiEncoder((colorize
+                        ? AnsiEncoder::PALETTE_BASIC
+                        : AnsiEncoder::PALETTE_NONE),
+                       randomColors).encode(*this);
 }
 
 size_t Lattice::getWidth() const
 {
-    return (lattice_.size() > 0
-            ? lattice_[0].size()
-            : 0);
+    return width_;
 }
 
 size_t Lattice::getHeight() const
 {
-    return lattice_.size();
+    return height_;
 }
 
 std::ostream &operator<<(std::ostream &out, const Lattice &lattice)
 {
     out << "Lattice (" << lattice.getHeight() << "x" << lattice.getWidth() << "):\n";
 
-    for (size_t i = 0; i < lattice.lattice_.size(); i++)
+    for (size_t i = 0; i < lattice.height_; i++)
     {
-        out << "[" << i << "]: " << lattice.lattice_[i].size() << " columns: ";
+        out << "[" << i << "]: " << lattice.width_ << " columns: ";
 
-        for (auto &element : lattice.lattice_[i])
+        for (size_t j = 0; j < lattice.width_; j++)
         {
-            out << element.fancy_;
+            out << lattice.getGlyphRow(i)[j];
         }
 
         out << "\n";
@@ -344,26 +653,75 @@ std::ostream &operator<<(std::ostream &out, const Lattice &lattice)
 
 Lattice *Lattice::removeBlankLines()
 {
-    for (ssize_t i = lattice_.size() - 1; i >= 0; i--)
+    size_t kept = 0;
+
+    // how many rows are kept before each one, if there are marks or groups
+    // to move
+    std::vector<int64_t> before((marks_.empty() && groups_.empty()
+                                 ? 0
+                                 : height_ + 1),
+                                0);
+
+    for (size_t i = 0; i < height_; i++)
     {
-        bool allBlank = true;
-        const auto &row = lattice_[i];
+        const char *row = getGlyphRow(i);
 
-        for (size_t j = 0; j < row.size(); j++)
+        if (! isBlank(row, width_))
         {
-            if (row[j].fancy_ != ' ')
+            // slide the row up over the blank ones
+            if (kept != i)
             {
-                allBlank = false;
-                break;
+                std::copy(row, row + width_, getGlyphRow(kept));
             }
+
+            kept++;
         }
 
-        if (allBlank)
+        if (! before.empty())
+        {
+            before[i + 1] = kept;
+        }
+    }
+
+    // keep the slack blank
+    for (size_t i = kept; i < height_; i++)
+    {
+        std::fill(getGlyphRow(i), getGlyphRow(i) + width_, ' ');
+    }
+
+    // the marks on the removed rows go with them
+    marks_.erase(std::remove_if(marks_.begin(),
+                                marks_.end(),
+                                [&before](const Position &mark) {
+                                    return before[mark.y + 1] == before[mark.y];
+                                }),
+                 marks_.end());
+
+    for (Position &mark : marks_)
+    {
+        mark.y = before[mark.y];
+    }
+
+    // and the groups shrink to the rows they keep, which are together now
+    auto group = groups_.begin();
+
+    for (auto that = groups_.begin(); that != groups_.end(); that++)
+    {
+        const int64_t top = before[that->area.y];
+        const int64_t bottom = before[that->area.y + that->area.height];
+
+        if (bottom > top)
         {
-            lattice_.erase(lattice_.begin() + i);
+            *group = *that;
+            group->area.y = top;
+            group->area.height = bottom - top;
+            group++;
         }
     }
 
+    groups_.erase(group, groups_.end());
+
+    height_ = kept;
     return this;
 }
 
@@ -381,75 +739,63 @@ bool Lattice::isGrouped() const
 
 void Lattice::flattenIds()
 {
-    int idNow = -1;
-
-    // first find how many non spaces there are
-    for (auto &row : lattice_)
+    if (hasUniformId() || width_ == 0 || height_ == 0)
     {
-        for (auto &element : row)
-        {
-            if (idNow == -1)
-            {
-                idNow = element.id_;
-            }
-            else
-            {
-                element.id_ = idNow;
-            }
-        }
+        return;
     }
+
+    // everything takes the id of the top left element
+    uniformId_ = getId(0, 0);
+    groups_.clear();
 }
 
 void Lattice::setNewId()
 {
-    // first find how many non spaces there are
-    for (auto &row : lattice_)
-    {
-        for (auto &element : row)
-        {
-            element.id_ = Lattice::currentId;
-        }
-    }
-
+    uniformId_ = Lattice::currentId;
+    groups_.clear();
     Lattice::currentId++;
 }
 
 void Lattice::setId(const Lattice &other)
 {
-    for (uint32_t y = 0; y < lattice_.size(); y++)
-    {
-        auto &row = lattice_[y];
-
-        for (uint32_t x = 0; x < row.size(); x++)
-        {
-            row[x].id_ = other.lattice_[y][x].id_;
-        }
-    }
+    copyIds(other, 0, 0, Rect(0, 0, width_, height_));
 }
 
 void Lattice::mark(const Position &position)
 {
-    lattice_.at(position.y).at(position.x).marked_ = true;
-}
+    if (position.x >= width_ || position.y >= height_)
+    {
+        throw std::out_of_range("Lattice::mark");
+    }
 
-#include <iostream>
+    marks_.push_back(position);
+}
 
-// Paste 'other' at every marked element
+// Paste 'other' at every marked position
 void Lattice::paste(const Lattice &other)
 {
-    for (uint32_t y = lattice_.size() - 1; y != static_cast<unsigned>(-1); y--)
+    // go from the bottom right, so the pastes overlap the same way no
+    // matter what order the marks were made in
+    std::sort(marks_.begin(),
+              marks_.end(),
+              [](const Position &left, const Position &right) {
+                  return (left.y != right.y
+                          ? left.y > right.y
+                          : left.x > right.x);
+              });
+    marks_.erase(std::unique(marks_.begin(),
+                             marks_.end(),
+                             [](const Position &left, const Position &right) {
+                                 return left.x == right.x && left.y == right.y;
+                             }),
+                 marks_.end());
+
+    // pasting at a mark never prepends, so the rest stay put
+    std::vector<Position> marks;
+    marks.swap(marks_);
+
+    for (const Position &mark : marks)
     {
-        auto &row = lattice_[y];
-
-        for (uint32_t x = row.size() - 1; x != static_cast<unsigned>(-1); x--)
-        {
-            auto &element = row[x];
-
-            if (element.marked_)
-            {
-                paste(other, x, y);
-                element.marked_ = false;
-            }
-        }
+        paste(other, mark.x, mark.y);
     }
 }
@@ -22,6 +22,8 @@
 #ifndef __LATTICE_H__
 #define __LATTICE_H__
 
+#include <cstdint>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -35,29 +37,52 @@ struct Position
 
 std::ostream &operator<<(std::ostream &out, const Position &position);
 
+struct Rect
+{
+    Rect(int32_t x, int32_t y, int32_t width, int32_t height);
+
+    Rect intersect(const Rect &other) const;
+    bool intersects(const Rect &other) const;
+    bool isEmpty() const;
+
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+};
+
 class Lattice
 {
 public:
-    struct Element
+    // an element's id, which picks its color. a blank element's id doesn't
+    // matter, and ids wrap around after 65535
+    typedef uint16_t Id;
+
+    // the elements of 'area' have the id 'id'
+    struct Group
     {
-        Element();
-        Element(char fancy, char regular, int id, bool marked);
-        Element(const Element &other);
-        Element &operator=(const Element &other);
-
-        char fancy_;
-        char regular_;
-        int id_;
-        bool marked_;
+        Rect area;
+        Id id;
     };
 
-    static unsigned int currentId;
+    // each thread has its own ids
+    static thread_local unsigned int currentId;
 
     // constructing
+    // 'regular' is the plain character that the fancy ones draw, which
+    // nothing needs once they're drawn, so it isn't kept
     Lattice();
     Lattice(const Lattice &other);
     Lattice(const std::vector<std::string> &fancyString, char regular);
 
+    // 'height' rows of 'width' characters, packed one after another
+    Lattice(const char *rows, size_t width, size_t height, char regular);
+
+    // a blank lattice of the given size, whose elements come from 'resource'
+    Lattice(size_t width,
+            size_t height,
+            std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
     // destructing
     virtual ~Lattice();
 
@@ -85,14 +110,44 @@ public:
     bool isGrouped() const;
 
     // marking and pasting
+    // a mark stays with its element as the lattice grows and shrinks
     void mark(const Position &position);
 
-    // replace the marked elements with 'other'
+    // paste 'other' at every marked position, all at once, and forget them
     void paste(const Lattice &other);
 
     // paste 'other' at position (x, y)
     Position paste(const Lattice &other, int x, int y);
 
+    // copy the part of 'other' within 'clip' so its top left lands at (x, y)
+    // 'clip' must lie within this lattice, which doesn't grow
+    // if 'id' isn't -1 then every copied element gets it, otherwise they
+    // keep theirs, plus 'idShift'
+    void blit(const Lattice &other,
+              int32_t x,
+              int32_t y,
+              const Rect &clip,
+              int id = -1,
+              int idShift = 0);
+
+    // blank out 'rect', which must lie within this lattice
+    void clear(const Rect &rect);
+
+    // copy 'other', without its leftmost 'clipLeft' columns, 'count' times
+    // in one pass: the first with its top left at (x, y), and each one after
+    // moved by ('stepX', 'stepY') and over the top of the one before
+    // copy i gets the id 'id' + i * 'idStep', unless 'id' is -1
+    // only the parts within this lattice are copied, and it doesn't grow
+    void stamp(const Lattice &other,
+               int32_t x,
+               int32_t y,
+               size_t count,
+               int32_t stepX,
+               int32_t stepY,
+               int32_t clipLeft = 0,
+               int id = -1,
+               int idStep = 0);
+
     // id setting
     void setId(const Lattice &other);
     void flattenIds();
@@ -101,9 +156,66 @@ public:
     // output
     std::string convertToString(bool colorize = true, bool randomColors = true) const;
     friend std::ostream &operator<<(std::ostream &out, const Lattice &lattice);
+    friend class AnsiEncoder;
 
 protected:
-    std::vector<std::vector<Element>> lattice_;
+    // the characters of row 'y', relative to the origin
+    char *getGlyphRow(size_t y);
+    const char *getGlyphRow(size_t y) const;
+
+    bool hasUniformId() const;
+
+    // the id of every element in the 'height' rows from 'top', written row
+    // by row to 'ids'
+    void getIds(Id *ids, size_t top, size_t height) const;
+
+    // the id of the element at (x, y)
+    Id getId(size_t x, size_t y) const;
+
+    // set the ids of 'area' to 'id'
+    void fillIds(const Rect &area, Id id);
+
+    // copy the ids of 'other' within 'area' so its top left lands at (x, y),
+    // adding 'idShift' to each
+    void copyIds(const Lattice &other,
+                 int32_t x,
+                 int32_t y,
+                 const Rect &area,
+                 int idShift = 0);
+
+    // make sure there is room for 'left', 'top', 'right' and 'bottom' more
+    // columns and rows around the current contents, without moving them
+    // in the common case
+    void reserve(size_t left, size_t top, size_t right, size_t bottom);
+
+    // drop the leftmost 'count' columns
+    void removeLeftColumns(size_t count);
+
+    //
+    // the characters are stored row-major in a buffer of 'stride_' columns.
+    // the visible lattice starts at (originX_, originY_) and everything
+    // outside of it is kept blank, so growing into the slack is free
+    //
+    std::pmr::vector<char> glyphs_;
+
+    //
+    // the ids aren't kept per element. everything starts with 'uniformId_',
+    // then each group, in order, gives its area its own id, so pasting a
+    // lattice only adds a group or two and coloring only needs the groups.
+    // most lattices have none
+    //
+    std::pmr::vector<Group> groups_;
+    Id uniformId_;
+    size_t stride_;
+    size_t originX_;
+    size_t originY_;
+    size_t width_;
+    size_t height_;
+
+    // marked positions, which are few, so they're kept apart from the
+    // elements
+    std::vector<Position> marks_;
+
     bool isGrouped_;
 };
 
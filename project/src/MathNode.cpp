@@ -0,0 +1,64 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "MathNode.h"
+
+MathNode::MathNode(Kind inKind, const std::string &inText, bool inGrouped)
+    : kind(inKind),
+      text(inText),
+      grouped(inGrouped),
+      shape(0)
+{
+}
+
+std::string MathNode::convertToString() const
+{
+    static const char *names[] = {
+        "",
+        "nested",
+        "",
+        "",
+        "",
+        "call",
+        "=",
+        "update"
+    };
+
+    if (kind == KIND_TEXT)
+    {
+        return text;
+    }
+
+    std::string result = "(";
+
+    if (grouped)
+    {
+        result += "grouped ";
+    }
+
+    result += (text.empty()
+               ? names[kind]
+               : text);
+
+    for (const MathNodePtr &child : children)
+    {
+        result += " " + child->convertToString();
+    }
+
+    return result + ")";
+}
@@ -0,0 +1,84 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A MathNode is what the Renderer lays out: a small tree of text,
+// arithmetic, calls and assignments. MathParser builds one directly from
+// the input, and TaffyBridge converts Taffy's parse of anything else
+//
+#ifndef __MATH_NODE_H__
+#define __MATH_NODE_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct MathNode;
+
+using MathNodePtr = std::unique_ptr<MathNode>;
+
+struct MathNode
+{
+    enum Kind
+    {
+        // a number, identifier or anything else that's shown as written
+        KIND_TEXT,
+
+        // holds one child that's never rendered at the top level, like the
+        // body of a function
+        KIND_NESTED,
+
+        // operands joined by an operator
+        KIND_DIVIDE,
+        KIND_RAISE,
+        KIND_ARITHMETIC,
+
+        // a receiver, then its arguments
+        KIND_CALL,
+
+        // an identifier, then its value
+        KIND_ASSIGNMENT,
+
+        // an identifier, its arguments, then its value
+        KIND_FUNCTION_UPDATE,
+
+        // how many kinds there are
+        KIND_COUNT
+    };
+
+    MathNode(Kind inKind, const std::string &inText = "", bool inGrouped = false);
+
+    // a string that shows the whole tree, like: (+ x (grouped * 2 y))
+    std::string convertToString() const;
+
+    Kind kind;
+
+    // the characters of a text, or the operator of an arithmetic
+    std::string text;
+
+    // whether an arithmetic was written in parentheses
+    bool grouped;
+
+    // the same for every tree that's the same as this one, once the
+    // Renderer has interned it
+    unsigned int shape;
+
+    std::vector<MathNodePtr> children;
+};
+
+#endif
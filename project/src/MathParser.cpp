@@ -0,0 +1,422 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cctype>
+#include <cstring>
+#include <unordered_set>
+
+#include "MathParser.h"
+
+// Taffy's keywords, which can't be identifiers
+static const std::unordered_set<std::string> sKeywords = {
+    "abstract", "and", "atomic", "break", "catch", "class", "const",
+    "else", "false", "final", "for", "global", "i", "if", "import", "in",
+    "local", "new", "nil", "no", "or", "package", "return", "self",
+    "slice", "super", "synchronized", "throw", "true", "try", "upSelf",
+    "while", "yes"
+};
+
+static bool isIdentifierCharacter(char value)
+{
+    return (isalnum((unsigned char)value) || value == '_');
+}
+
+MathParser::MathParser(const std::string &input)
+    : input_(input),
+      position_(0)
+{
+}
+
+MathParser::~MathParser()
+{
+}
+
+MathNodePtr MathParser::parse()
+{
+    position_ = 0;
+
+    // Taffy reads these as increment and decrement
+    if (input_.find("--") != std::string::npos
+        || input_.find("++") != std::string::npos)
+    {
+        return nullptr;
+    }
+
+    MathNodePtr result = parseAssignment();
+
+    if (result == nullptr)
+    {
+        position_ = 0;
+        result = parseSum();
+    }
+
+    skipSpace();
+
+    if (position_ != input_.length())
+    {
+        // there's something we don't know at the end, like: x y
+        result.reset();
+    }
+
+    return result;
+}
+
+MathNodePtr MathParser::parseAssignment()
+{
+    skipSpace();
+
+    MathNodePtr name = parseIdentifier();
+    skipSpace();
+
+    if (name == nullptr
+        || peek() != '='
+        || (position_ + 1 < input_.length()
+            && input_[position_ + 1] == '='))
+    {
+        return nullptr;
+    }
+
+    position_++;
+
+    MathNodePtr value = parseSum();
+
+    if (value == nullptr)
+    {
+        return nullptr;
+    }
+
+    MathNodePtr result(new MathNode(MathNode::KIND_ASSIGNMENT));
+    result->children.push_back(std::move(name));
+    result->children.push_back(std::move(value));
+    return result;
+}
+
+MathNodePtr MathParser::parseSum()
+{
+    MathNodePtr result = parseProduct();
+
+    while (result != nullptr)
+    {
+        skipSpace();
+        const char op = peek();
+
+        if (op != '+' && op != '-')
+        {
+            break;
+        }
+
+        position_++;
+
+        MathNodePtr right = parseProduct();
+        result = (right != nullptr
+                  ? combine(op, std::move(result), std::move(right))
+                  : nullptr);
+    }
+
+    return result;
+}
+
+MathNodePtr MathParser::parseProduct()
+{
+    MathNodePtr result = parsePower();
+
+    while (result != nullptr)
+    {
+        skipSpace();
+        const char op = peek();
+
+        if (op != '*' && op != '/')
+        {
+            break;
+        }
+
+        position_++;
+
+        MathNodePtr right = parsePower();
+        result = (right != nullptr
+                  ? combine(op, std::move(result), std::move(right))
+                  : nullptr);
+    }
+
+    return result;
+}
+
+MathNodePtr MathParser::parsePower()
+{
+    MathNodePtr result = parseOperand();
+
+    if (result == nullptr)
+    {
+        return nullptr;
+    }
+
+    skipSpace();
+
+    if (peek() == '^')
+    {
+        position_++;
+
+        // ^ is right associative: a^b^c is a^(b^c)
+        MathNodePtr exponent = parsePower();
+        result = (exponent != nullptr
+                  ? combine('^', std::move(result), std::move(exponent))
+                  : nullptr);
+    }
+
+    return result;
+}
+
+MathNodePtr MathParser::parseOperand()
+{
+    skipSpace();
+    const char value = peek();
+
+    if (value == '(')
+    {
+        position_++;
+
+        MathNodePtr result = parseSum();
+        skipSpace();
+
+        if (result == nullptr || peek() != ')')
+        {
+            return nullptr;
+        }
+
+        position_++;
+
+        // only arithmetic remembers its parentheses: (x) is just x
+        if (result->kind != MathNode::KIND_TEXT
+            && result->kind != MathNode::KIND_CALL)
+        {
+            result->grouped = true;
+        }
+
+        return result;
+    }
+    else if (value == '-')
+    {
+        // Taffy only keeps a minus with a number that's by itself, so -4 is
+        // a number, but -x and -4^2 are multiplied by -1
+        position_++;
+        skipSpace();
+
+        if (! isdigit((unsigned char)peek()))
+        {
+            return nullptr;
+        }
+
+        return parseNumber(true);
+    }
+    else if (isdigit((unsigned char)value))
+    {
+        return parseNumber(false);
+    }
+
+    MathNodePtr name = parseIdentifier();
+
+    if (name == nullptr)
+    {
+        return nullptr;
+    }
+
+    const size_t end = position_;
+    skipSpace();
+
+    if (peek() == '(')
+    {
+        return parseCall(std::move(name));
+    }
+
+    position_ = end;
+    return name;
+}
+
+MathNodePtr MathParser::parseNumber(bool negative)
+{
+    const size_t start = position_;
+
+    while (isdigit((unsigned char)peek()))
+    {
+        position_++;
+    }
+
+    // Taffy doesn't read leading zeros
+    if (input_[start] == '0' && position_ - start > 1)
+    {
+        return nullptr;
+    }
+
+    if (peek() == '.')
+    {
+        position_++;
+
+        if (! isdigit((unsigned char)peek()))
+        {
+            return nullptr;
+        }
+
+        while (isdigit((unsigned char)peek()))
+        {
+            position_++;
+        }
+    }
+
+    // 2x and 1e5 are multiplications, 0x10 is hex and 2i is complex
+    if (isIdentifierCharacter(peek()) || peek() == '.')
+    {
+        return nullptr;
+    }
+
+    std::string text = input_.substr(start, position_ - start);
+
+    if (negative)
+    {
+        // -0 is just 0
+        if (text == "0")
+        {
+            return nullptr;
+        }
+
+        const size_t end = position_;
+        skipSpace();
+
+        // the end (0) is fine too
+        if (strchr("+-,)", peek()) == NULL)
+        {
+            return nullptr;
+        }
+
+        position_ = end;
+        text = "-" + text;
+    }
+
+    return MathNodePtr(new MathNode(MathNode::KIND_TEXT, text));
+}
+
+MathNodePtr MathParser::parseIdentifier()
+{
+    const size_t start = position_;
+
+    if (! (isalpha((unsigned char)peek()) || peek() == '_'))
+    {
+        return nullptr;
+    }
+
+    while (isIdentifierCharacter(peek()))
+    {
+        position_++;
+    }
+
+    const std::string name = input_.substr(start, position_ - start);
+
+    if (sKeywords.find(name) != sKeywords.end())
+    {
+        return nullptr;
+    }
+
+    return MathNodePtr(new MathNode(MathNode::KIND_TEXT, name));
+}
+
+MathNodePtr MathParser::parseCall(MathNodePtr name)
+{
+    MathNodePtr result(new MathNode(MathNode::KIND_CALL));
+    result->children.push_back(std::move(name));
+
+    // skip the (
+    position_++;
+
+    while (true)
+    {
+        MathNodePtr argument = parseSum();
+
+        if (argument == nullptr)
+        {
+            return nullptr;
+        }
+
+        result->children.push_back(std::move(argument));
+        skipSpace();
+
+        if (peek() == ')')
+        {
+            position_++;
+            break;
+        }
+        else if (peek() != ',')
+        {
+            return nullptr;
+        }
+
+        position_++;
+    }
+
+    return result;
+}
+
+MathNodePtr MathParser::combine(char op, MathNodePtr left, MathNodePtr right)
+{
+    const MathNode::Kind kind = (op == '/'
+                                 ? MathNode::KIND_DIVIDE
+                                 : (op == '^'
+                                    ? MathNode::KIND_RAISE
+                                    : MathNode::KIND_ARITHMETIC));
+    MathNodePtr result(new MathNode(kind, std::string(1, op)));
+
+    // like Taffy, fold a + or * into a + or * on either side, even when
+    // it's grouped, and a - into a - on the left. / and ^ never fold
+    const bool foldLeft = (op == '+' || op == '*' || op == '-');
+    const bool foldRight = (op == '+' || op == '*');
+
+    for (MathNodePtr *side : {&left, &right})
+    {
+        MathNode &node = **side;
+
+        if (node.kind == kind
+            && node.text == result->text
+            && (side == &left ? foldLeft : foldRight))
+        {
+            for (MathNodePtr &child : node.children)
+            {
+                result->children.push_back(std::move(child));
+            }
+        }
+        else
+        {
+            result->children.push_back(std::move(*side));
+        }
+    }
+
+    return result;
+}
+
+void MathParser::skipSpace()
+{
+    while (position_ < input_.length()
+           && (input_[position_] == ' ' || input_[position_] == '\t'))
+    {
+        position_++;
+    }
+}
+
+char MathParser::peek() const
+{
+    return (position_ < input_.length()
+            ? input_[position_]
+            : 0);
+}
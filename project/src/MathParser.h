@@ -0,0 +1,80 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A MathParser turns plain algebra into a MathNode without going through
+// Taffy. It reads numbers, identifiers, + - * / ^, calls, parentheses and
+// assignments, and builds the same tree Taffy would, so the two render
+// alike
+//
+// Anything else, or anything Taffy reads in a surprising way (2x, -x, x y),
+// is rejected, and left for Taffy to parse
+//
+#ifndef __MATH_PARSER_H__
+#define __MATH_PARSER_H__
+
+#include <string>
+
+#include "MathNode.h"
+
+class MathParser
+{
+public:
+    MathParser(const std::string &input);
+    virtual ~MathParser();
+
+    // can't copy
+    MathParser(const MathParser &other) = delete;
+    MathParser &operator=(const MathParser &other) = delete;
+
+    // the tree for the input, or nullptr if it's rejected
+    MathNodePtr parse();
+
+protected:
+    // identifier = sum
+    MathNodePtr parseAssignment();
+
+    // product, joined by + or -
+    MathNodePtr parseSum();
+
+    // power, joined by * or /
+    MathNodePtr parseProduct();
+
+    // operand, raised to a power
+    MathNodePtr parsePower();
+
+    // a number, identifier, call or parenthesized sum
+    MathNodePtr parseOperand();
+
+    MathNodePtr parseNumber(bool negative);
+    MathNodePtr parseIdentifier();
+    MathNodePtr parseCall(MathNodePtr name);
+
+    // join 'left' and 'right' like Taffy does, flattening where it does
+    static MathNodePtr combine(char op, MathNodePtr left, MathNodePtr right);
+
+    void skipSpace();
+
+    // the next character, or 0 at the end
+    char peek() const;
+
+    const std::string input_;
+    size_t position_;
+};
+
+#endif
@@ -17,11 +17,21 @@
 //
 
 #include <iostream>
+#include <fstream>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 #include "PPMApp.h"
+#include "Profile.h"
 #include "TaffyBridge.h"
 #include "Renderer.h"
 #include "FontFactory.h"
+#include "RenderClient.h"
+#include "RenderServer.h"
+#include "RenderSession.h"
 
 extern "C"
 {
@@ -40,30 +50,36 @@ extern "C"
         return new PPMApp();
     }
 
-    char *renderResult = NULL;
+    // each thread keeps its own last result
+    static thread_local char *sRenderResult = NULL;
 
+    // see ppm.h for an API that doesn't hard-code the options
     char *PPM_render(PPMApp *app, char *input)
     {
-        if (renderResult != NULL)
+        if (sRenderResult != NULL)
         {
-            free(renderResult);
+            free(sRenderResult);
         }
 
-        // initialize the random seed
-        srand(time(0));
         std::string result;
 
         try
         {
-            result = app->execute(input, "small", "alternating", true);
+            result = app->execute(input, "small", "alternating", "basic", true);
         }
         catch (std::exception &exception)
         {
             result = exception.what();
         }
 
-        renderResult = strdup(result.c_str());
-        return renderResult;
+        sRenderResult = strdup(result.c_str());
+        return sRenderResult;
+    }
+
+    void PPM_getCacheStatistics(PPMApp *app, unsigned long *hits, unsigned long *misses)
+    {
+        *hits = app->getCache().getHits();
+        *misses = app->getCache().getMisses();
     }
 }
 
@@ -71,6 +87,11 @@ PPMApp::PPMApp() noexcept
 {
 }
 
+RenderCache &PPMApp::getCache()
+{
+    return cache_;
+}
+
 bool PPMApp::execute(int argc, char **argv)
 {
     CommandLineArguments arguments;
@@ -80,13 +101,57 @@ bool PPMApp::execute(int argc, char **argv)
         return false;
     }
 
+    if (! arguments.isProfile())
+    {
+        return execute(arguments);
+    }
+
+    Profile profile;
+    bool result;
+
+    {
+        Profile::Recorder recorder(&profile);
+        result = execute(arguments);
+    }
+
+    profile.write(std::cerr);
+    return result;
+}
+
+bool PPMApp::execute(const CommandLineArguments &arguments)
+{
+    if (arguments.isServe())
+    {
+        return executeServe(arguments);
+    }
+
+    if (arguments.isClient())
+    {
+        return executeClient(arguments);
+    }
+
+    if (arguments.isBatch())
+    {
+        return executeBatch(arguments);
+    }
+
+    if (arguments.isWatch())
+    {
+        return executeWatch(arguments);
+    }
+
     try
     {
-        std::string output = execute(arguments.getText(),
-                                     arguments.getFontType(),
-                                     arguments.getColorMode(),
-                                     arguments.useRandomColors());
-        std::cout << output << std::endl;
+        // stream it, since a big render can be much bigger as text
+        Renderer renderer(FontFactory::getInstance().createFont(arguments.getFontType()),
+                          Renderer::getColorMode(arguments.getColorMode()),
+                          arguments.useRandomColors(),
+                          AnsiEncoder::getPalette(arguments.getPalette()));
+        renderer.setCache(&cache_);
+        renderer.render(arguments.getText(), [](const char *text, size_t length) {
+                std::cout.write(text, length);
+            });
+        std::cout << std::endl;
     }
     catch (std::exception &exception)
     {
@@ -100,10 +165,419 @@ bool PPMApp::execute(int argc, char **argv)
 std::string PPMApp::execute(const std::string &maths,
                             const std::string &fontTypeString,
                             const std::string &colorModeString,
+                            const std::string &paletteString,
                             bool useRandomColors)
 {
     Renderer renderer(FontFactory::getInstance().createFont(fontTypeString),
                       Renderer::getColorMode(colorModeString),
-                      useRandomColors);
+                      useRandomColors,
+                      AnsiEncoder::getPalette(paletteString));
+    renderer.setCache(&cache_);
     return renderer.render(maths);
 }
+
+bool PPMApp::executeBatch(const CommandLineArguments &arguments)
+{
+    if (arguments.getBatchFile() == "-")
+    {
+        return executeBatch(std::cin,
+                            std::cout,
+                            arguments.getFontType(),
+                            arguments.getColorMode(),
+                            arguments.getPalette(),
+                            arguments.useRandomColors(),
+                            arguments.getJobs());
+    }
+
+    std::ifstream infile(arguments.getBatchFile());
+
+    if (! infile)
+    {
+        std::cout << "Error: can't open batch file: " << arguments.getBatchFile() << "\n";
+        return false;
+    }
+
+    return executeBatch(infile,
+                        std::cout,
+                        arguments.getFontType(),
+                        arguments.getColorMode(),
+                        arguments.getPalette(),
+                        arguments.useRandomColors(),
+                        arguments.getJobs());
+}
+
+bool PPMApp::executeServe(const CommandLineArguments &arguments)
+{
+    try
+    {
+        RenderServer server(arguments.getServePath(), cache_);
+        server.serve();
+    }
+    catch (std::exception &exception)
+    {
+        std::cout << "Error: " << exception.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool PPMApp::executeClient(const CommandLineArguments &arguments)
+{
+    const RenderRequest request = {arguments.getFontType(),
+                                   arguments.getColorMode(),
+                                   arguments.getPalette(),
+                                   arguments.useRandomColors(),
+                                   arguments.getText()};
+    RenderResponse response;
+
+    try
+    {
+        RenderClient client(arguments.getConnectPath());
+        response = client.render(request);
+    }
+    catch (std::exception &exception)
+    {
+        std::cout << "Error: " << exception.what() << "\n";
+        return false;
+    }
+
+    if (response.success)
+    {
+        std::cout << response.text << std::endl;
+    }
+    else
+    {
+        std::cout << "Error: " << response.text << "\n";
+    }
+
+    return response.success;
+}
+
+// trim a line of a batch, including any carriage return
+static std::string trimLine(const std::string &line)
+{
+    const size_t begin = line.find_first_not_of(" \t\r");
+    const size_t end = line.find_last_not_of(" \t\r");
+
+    return (begin == std::string::npos
+            ? ""
+            : line.substr(begin, end - begin + 1));
+}
+
+// render one line of a batch into 'rendered'
+// an empty line gets an empty result, so the output stays in step with the
+// input
+static bool renderLine(Renderer &renderer, const std::string &line, std::string &rendered)
+{
+    bool result = true;
+
+    if (line == "")
+    {
+        rendered = "";
+    }
+    else
+    {
+        try
+        {
+            rendered = renderer.render(line) + "\n";
+        }
+        catch (std::exception &exception)
+        {
+            rendered = std::string("Error: ") + exception.what() + "\n";
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+// render line 'index' of a batch straight to 'output', like renderLine()
+// then writeLine() would
+static bool streamLine(Renderer &renderer,
+                       const std::string &line,
+                       std::ostream &output,
+                       size_t index)
+{
+    bool result = true;
+
+    if (index > 0)
+    {
+        output << "\n";
+    }
+
+    if (line != "")
+    {
+        // a render only fails before it writes anything
+        try
+        {
+            renderer.render(line, [&output](const char *text, size_t length) {
+                    output.write(text, length);
+                });
+            output << "\n";
+        }
+        catch (std::exception &exception)
+        {
+            output << "Error: " << exception.what() << "\n";
+            result = false;
+        }
+    }
+
+    output.flush();
+    return result;
+}
+
+// write the result of line 'index' of a batch
+static void writeLine(std::ostream &output, size_t index, const std::string &rendered)
+{
+    if (index > 0)
+    {
+        output << "\n";
+    }
+
+    output << rendered;
+    output.flush();
+}
+
+// what the threads rendering a batch share
+struct BatchState
+{
+    std::mutex mutex;
+
+    // lines wait in 'pending' to be rendered, then in 'finished' until
+    // every line before them has been written
+    std::deque<std::pair<size_t, std::string>> pending;
+    std::map<size_t, std::string> finished;
+    std::condition_variable linePending;
+    std::condition_variable lineWritten;
+
+    size_t nextToWrite = 0;
+    bool inputDone = false;
+    bool success = true;
+};
+
+static void renderBatchLines(BatchState &state,
+                             RenderCache &cache,
+                             std::ostream &output,
+                             Font *font,
+                             Renderer::ColorMode colorMode,
+                             AnsiEncoder::Palette palette,
+                             bool useRandomColors,
+                             Profile *profile)
+{
+    TaffyBridge::getInstance().registerThread();
+
+    // each worker records on its own, and adds it up at the end
+    Profile workerProfile;
+
+    {
+        Profile::Recorder recorder(profile != NULL
+                                   ? &workerProfile
+                                   : NULL);
+        Renderer renderer(font, colorMode, useRandomColors, palette);
+        renderer.setCache(&cache);
+        std::unique_lock<std::mutex> lock(state.mutex);
+
+        while (true)
+        {
+            state.linePending.wait(lock, [&state] {
+                    return ! state.pending.empty() || state.inputDone;
+                });
+
+            if (state.pending.empty())
+            {
+                // all done
+                break;
+            }
+
+            std::pair<size_t, std::string> line = std::move(state.pending.front());
+            state.pending.pop_front();
+            lock.unlock();
+
+            std::string rendered;
+            bool success = renderLine(renderer, line.second, rendered);
+
+            lock.lock();
+            state.success = state.success && success;
+            state.finished[line.first] = std::move(rendered);
+
+            // write everything that's now in order
+            for (auto found = state.finished.find(state.nextToWrite);
+                 found != state.finished.end();
+                 found = state.finished.find(state.nextToWrite))
+            {
+                writeLine(output, found->first, found->second);
+                state.finished.erase(found);
+                state.nextToWrite++;
+            }
+
+            state.lineWritten.notify_one();
+        }
+    }
+
+    if (profile != NULL)
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        profile->add(workerProfile);
+    }
+
+    TaffyBridge::getInstance().unregisterThread();
+}
+
+bool PPMApp::executeBatch(std::istream &input,
+                          std::ostream &output,
+                          const std::string &fontTypeString,
+                          const std::string &colorModeString,
+                          const std::string &paletteString,
+                          bool useRandomColors,
+                          unsigned int jobs)
+{
+    Font *font = NULL;
+    Renderer::ColorMode colorMode;
+    AnsiEncoder::Palette palette;
+
+    // every line shares the font, so it's set up once
+    try
+    {
+        font = FontFactory::getInstance().createFont(fontTypeString);
+        colorMode = Renderer::getColorMode(colorModeString);
+        palette = AnsiEncoder::getPalette(paletteString);
+    }
+    catch (std::exception &exception)
+    {
+        output << "Error: " << exception.what() << "\n";
+        return false;
+    }
+
+    std::string line;
+
+    if (jobs <= 1)
+    {
+        // render the lines right here
+        Renderer renderer(font, colorMode, useRandomColors, palette);
+        renderer.setCache(&cache_);
+        bool result = true;
+
+        for (size_t count = 0; std::getline(input, line); count++)
+        {
+            result = streamLine(renderer, trimLine(line), output, count) && result;
+        }
+
+        return result;
+    }
+
+    // otherwise each worker renders lines as they're read, and the output
+    // is put back in order
+    BatchState state;
+    std::vector<std::thread> workers;
+
+    for (unsigned int i = 0; i < jobs; i++)
+    {
+        workers.push_back(std::thread(&renderBatchLines,
+                                      std::ref(state),
+                                      std::ref(cache_),
+                                      std::ref(output),
+                                      font,
+                                      colorMode,
+                                      palette,
+                                      useRandomColors,
+                                      Profile::current));
+    }
+
+    for (size_t count = 0; std::getline(input, line); count++)
+    {
+        std::unique_lock<std::mutex> lock(state.mutex);
+
+        // don't read too far ahead of the output
+        state.lineWritten.wait(lock, [&state, count, jobs] {
+                return count - state.nextToWrite < 4 * jobs;
+            });
+
+        state.pending.push_back(std::make_pair(count, trimLine(line)));
+        state.linePending.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.inputDone = true;
+    }
+
+    state.linePending.notify_all();
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    return state.success;
+}
+
+bool PPMApp::executeWatch(const CommandLineArguments &arguments)
+{
+    std::unique_ptr<RenderSession> session;
+
+    try
+    {
+        session.reset(new RenderSession(FontFactory::getInstance().createFont(arguments.getFontType()),
+                                        Renderer::getColorMode(arguments.getColorMode()),
+                                        arguments.useRandomColors(),
+                                        AnsiEncoder::getPalette(arguments.getPalette())));
+    }
+    catch (std::exception &exception)
+    {
+        std::cout << "Error: " << exception.what() << "\n";
+        return false;
+    }
+
+    session->getRenderer().setCache(&cache_);
+
+    // the number of rows showing, which the cursor is just below
+    size_t height = 0;
+
+    // only the last render counts, since the ones before it are often
+    // half typed
+    bool result = true;
+
+    auto redraw = [&session, &height, &result](const std::string &maths) {
+        // go back to the top row
+        if (height > 0)
+        {
+            std::cout << "\033[" << height << "F";
+        }
+
+        size_t row = 0;
+        result = true;
+
+        try
+        {
+            height = session->render(maths, [&row](size_t changed, const std::string &text) {
+                    // move down to the row, and write over it
+                    std::cout << std::string(changed - row, '\n') << "\033[2K" << text;
+                    row = changed;
+                });
+        }
+        catch (std::exception &exception)
+        {
+            std::cout << "\033[2K" << "Error: " << exception.what();
+            height = 1;
+            result = false;
+        }
+
+        // go below the rows, and clear what's left of the last render
+        std::cout << std::string(height - row, '\n') << "\033[J" << std::flush;
+    };
+
+    if (arguments.getText() != "")
+    {
+        redraw(arguments.getText());
+    }
+
+    std::string line;
+
+    while (std::getline(std::cin, line))
+    {
+        redraw(trimLine(line));
+    }
+
+    return result;
+}
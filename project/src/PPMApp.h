@@ -19,8 +19,11 @@
 #ifndef __PPM_APP_H__
 #define __PPM_APP_H__
 
+#include <iostream>
+
 #include "Font.h"
 #include "CommandLineArguments.h"
+#include "RenderCache.h"
 
 class PPMApp
 {
@@ -32,7 +35,32 @@ public:
     std::string execute(const std::string &maths,
                         const std::string &fontTypeString,
                         const std::string &colorModeString,
+                        const std::string &paletteString,
                         bool useRandomColors);
+
+    // render each line of 'input' to 'output' with 'jobs' threads,
+    // separating the results with an empty line and keeping them in order
+    // each result is written as soon as the ones before it are
+    // returns false if any line failed
+    bool executeBatch(std::istream &input,
+                      std::ostream &output,
+                      const std::string &fontTypeString,
+                      const std::string &colorModeString,
+                      const std::string &paletteString,
+                      bool useRandomColors,
+                      unsigned int jobs = 1);
+
+    // renders are cached here, by input, font, color mode and spacing
+    RenderCache &getCache();
+
+protected:
+    bool execute(const CommandLineArguments &arguments);
+    bool executeBatch(const CommandLineArguments &arguments);
+    bool executeServe(const CommandLineArguments &arguments);
+    bool executeClient(const CommandLineArguments &arguments);
+    bool executeWatch(const CommandLineArguments &arguments);
+
+    RenderCache cache_;
 };
 
 extern "C"
@@ -41,6 +69,7 @@ extern "C"
 
     PPMApp *PPM_new(void);
     char *PPM_render(PPMApp *app, char *input);
+    void PPM_getCacheStatistics(PPMApp *app, unsigned long *hits, unsigned long *misses);
     char *testMe(void);
 }
 
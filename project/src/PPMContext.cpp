@@ -0,0 +1,375 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "FontFactory.h"
+#include "PPMContext.h"
+
+PPMContext::PPMContext()
+    : font_(FontFactory::getInstance().createFont("small")),
+      colorMode_(Renderer::COLOR_MODE_ALTERNATING),
+      palette_(AnsiEncoder::PALETTE_BASIC),
+      randomColors_(true),
+      hasSeed_(false),
+      seed_(0),
+      hasPending_(false),
+      profiling_(false)
+{
+}
+
+PPMContext::~PPMContext()
+{
+}
+
+void PPMContext::setFont(const std::string &fontType)
+{
+    font_ = FontFactory::getInstance().createFont(fontType);
+    renderer_.reset();
+    session_.reset();
+    hasPending_ = false;
+}
+
+void PPMContext::setColorMode(const std::string &colorMode)
+{
+    colorMode_ = Renderer::getColorMode(colorMode);
+    renderer_.reset();
+    session_.reset();
+    hasPending_ = false;
+}
+
+void PPMContext::setPalette(const std::string &palette)
+{
+    palette_ = AnsiEncoder::getPalette(palette);
+    renderer_.reset();
+    session_.reset();
+    hasPending_ = false;
+}
+
+void PPMContext::setRandomColors(bool randomColors)
+{
+    randomColors_ = randomColors;
+    renderer_.reset();
+    session_.reset();
+    hasPending_ = false;
+}
+
+void PPMContext::setSeed(unsigned long seed)
+{
+    hasSeed_ = true;
+    seed_ = seed;
+
+    if (renderer_ != nullptr)
+    {
+        renderer_->setSeed(seed);
+    }
+
+    if (session_ != nullptr)
+    {
+        session_->getRenderer().setSeed(seed);
+    }
+
+    hasPending_ = false;
+}
+
+void PPMContext::setCacheCapacity(size_t capacity)
+{
+    cache_.setCapacity(capacity);
+}
+
+Renderer &PPMContext::getRenderer()
+{
+    if (renderer_ == nullptr)
+    {
+        renderer_.reset(new Renderer(font_, colorMode_, randomColors_, palette_));
+        renderer_->setCache(&cache_);
+
+        if (hasSeed_)
+        {
+            renderer_->setSeed(seed_);
+        }
+    }
+
+    return *renderer_;
+}
+
+RenderSession &PPMContext::getSession()
+{
+    if (session_ == nullptr)
+    {
+        session_.reset(new RenderSession(font_, colorMode_, randomColors_, palette_));
+        session_->getRenderer().setCache(&cache_);
+
+        if (hasSeed_)
+        {
+            session_->getRenderer().setSeed(seed_);
+        }
+    }
+
+    return *session_;
+}
+
+size_t PPMContext::render(const std::string &maths, char *buffer, size_t size)
+{
+    if (! hasPending_ || pendingInput_ != maths)
+    {
+        Profile::Recorder recorder(profiling_
+                                   ? &profile_
+                                   : NULL);
+        pendingResult_ = getRenderer().render(maths);
+        pendingInput_ = maths;
+        hasPending_ = true;
+    }
+
+    const size_t length = pendingResult_.length();
+
+    if (buffer != NULL && length < size)
+    {
+        memcpy(buffer, pendingResult_.c_str(), length + 1);
+        hasPending_ = false;
+    }
+
+    return length;
+}
+
+size_t PPMContext::render(const std::string &maths, const Renderer::Sink &sink)
+{
+    Profile::Recorder recorder(profiling_
+                               ? &profile_
+                               : NULL);
+    return getRenderer().render(maths, sink);
+}
+
+size_t PPMContext::renderChanges(const std::string &maths, const RenderSession::RowSink &sink)
+{
+    Profile::Recorder recorder(profiling_
+                               ? &profile_
+                               : NULL);
+    return getSession().render(maths, sink);
+}
+
+void PPMContext::setError(const std::string &error)
+{
+    error_ = error;
+}
+
+const std::string &PPMContext::getError() const
+{
+    return error_;
+}
+
+void PPMContext::setProfiling(bool profiling)
+{
+    if (profiling && ! profiling_)
+    {
+        profile_.clear();
+    }
+
+    profiling_ = profiling;
+}
+
+const std::string &PPMContext::getProfile()
+{
+    std::ostringstream json;
+    profile_.writeJson(json);
+    profileJson_ = json.str();
+    return profileJson_;
+}
+
+// set an option, turning an exception into an error
+template <typename Setter>
+static int setOption(PPMContext *context, Setter setter)
+{
+    try
+    {
+        setter();
+    }
+    catch (std::exception &exception)
+    {
+        context->setError(exception.what());
+        return -1;
+    }
+
+    context->setError("");
+    return 0;
+}
+
+extern "C"
+{
+    PPMContext *PPM_createContext(void)
+    {
+        try
+        {
+            return new PPMContext();
+        }
+        catch (std::exception &exception)
+        {
+            return NULL;
+        }
+    }
+
+    void PPM_freeContext(PPMContext *context)
+    {
+        delete context;
+    }
+
+    int PPM_setFont(PPMContext *context, const char *font)
+    {
+        return setOption(context, [context, font] { context->setFont(font); });
+    }
+
+    int PPM_setColorMode(PPMContext *context, const char *colorMode)
+    {
+        return setOption(context, [context, colorMode] { context->setColorMode(colorMode); });
+    }
+
+    int PPM_setPalette(PPMContext *context, const char *palette)
+    {
+        return setOption(context, [context, palette] { context->setPalette(palette); });
+    }
+
+    void PPM_setRandomColors(PPMContext *context, int randomColors)
+    {
+        context->setRandomColors(randomColors != 0);
+    }
+
+    void PPM_setSeed(PPMContext *context, unsigned long seed)
+    {
+        context->setSeed(seed);
+    }
+
+    void PPM_setCacheCapacity(PPMContext *context, size_t capacity)
+    {
+        context->setCacheCapacity(capacity);
+    }
+
+    long PPM_renderToBuffer(PPMContext *context, const char *input, char *buffer, size_t size)
+    {
+        long result = -1;
+
+        try
+        {
+            result = (long)context->render(input, buffer, size);
+            context->setError("");
+        }
+        catch (std::exception &exception)
+        {
+            context->setError(exception.what());
+        }
+
+        return result;
+    }
+
+    long PPM_renderToCallback(PPMContext *context,
+                              const char *input,
+                              PPMWriteFunction write,
+                              void *data)
+    {
+        long result = -1;
+
+        try
+        {
+            result = (long)context->render(input, [write, data](const char *text, size_t length) {
+                    write(text, length, data);
+                });
+            context->setError("");
+        }
+        catch (std::exception &exception)
+        {
+            context->setError(exception.what());
+        }
+
+        return result;
+    }
+
+    long PPM_renderToFd(PPMContext *context, const char *input, int fd)
+    {
+        long result = -1;
+
+        try
+        {
+            result = (long)context->render(input, [fd](const char *text, size_t length) {
+                    for (size_t written = 0; written < length;)
+                    {
+                        const ssize_t count = ::write(fd, text + written, length - written);
+
+                        if (count < 0 && errno == EINTR)
+                        {
+                            continue;
+                        }
+                        else if (count <= 0)
+                        {
+                            throw std::runtime_error(std::string("can't write: ")
+                                                     + strerror(errno));
+                        }
+
+                        written += count;
+                    }
+                });
+            context->setError("");
+        }
+        catch (std::exception &exception)
+        {
+            context->setError(exception.what());
+        }
+
+        return result;
+    }
+
+    long PPM_renderChanges(PPMContext *context,
+                           const char *input,
+                           PPMRowFunction row,
+                           void *data)
+    {
+        long result = -1;
+
+        try
+        {
+            result = (long)context->renderChanges(input, [row, data](size_t changed, const std::string &text) {
+                    row(changed, text.data(), text.length(), data);
+                });
+            context->setError("");
+        }
+        catch (std::exception &exception)
+        {
+            context->setError(exception.what());
+        }
+
+        return result;
+    }
+
+    const char *PPM_getError(const PPMContext *context)
+    {
+        return context->getError().c_str();
+    }
+
+    void PPM_setProfiling(PPMContext *context, int profiling)
+    {
+        context->setProfiling(profiling != 0);
+    }
+
+    const char *PPM_getProfile(PPMContext *context)
+    {
+        return context->getProfile().c_str();
+    }
+}
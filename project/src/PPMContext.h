@@ -0,0 +1,106 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A PPMContext is what the C API hands out. It renders with its own
+// options, colors and cache
+//
+#ifndef __PPM_CONTEXT_H__
+#define __PPM_CONTEXT_H__
+
+#include <memory>
+#include <string>
+
+#include "AnsiEncoder.h"
+#include "Font.h"
+#include "Profile.h"
+#include "RenderCache.h"
+#include "RenderSession.h"
+#include "Renderer.h"
+#include "ppm.h"
+
+struct PPMContext
+{
+    PPMContext();
+    virtual ~PPMContext();
+
+    // can't copy
+    PPMContext(const PPMContext &other) = delete;
+    PPMContext &operator=(const PPMContext &other) = delete;
+
+    // throw std::runtime_error for unknown values
+    void setFont(const std::string &fontType);
+    void setColorMode(const std::string &colorMode);
+    void setPalette(const std::string &palette);
+
+    void setRandomColors(bool randomColors);
+    void setSeed(unsigned long seed);
+    void setCacheCapacity(size_t capacity);
+
+    // render 'maths' into 'buffer', see PPM_renderToBuffer
+    // throws std::runtime_error
+    size_t render(const std::string &maths, char *buffer, size_t size);
+
+    // render 'maths' to 'sink', see PPM_renderToCallback
+    // throws std::runtime_error
+    size_t render(const std::string &maths, const Renderer::Sink &sink);
+
+    // render 'maths' with the session, see PPM_renderChanges
+    // throws std::runtime_error
+    size_t renderChanges(const std::string &maths, const RenderSession::RowSink &sink);
+
+    void setError(const std::string &error);
+    const std::string &getError() const;
+
+    void setProfiling(bool profiling);
+
+    // see PPM_getProfile
+    const std::string &getProfile();
+
+protected:
+    // the renderer for the current options
+    Renderer &getRenderer();
+    RenderSession &getSession();
+
+    Font *font_;
+    Renderer::ColorMode colorMode_;
+    AnsiEncoder::Palette palette_;
+    bool randomColors_;
+    bool hasSeed_;
+    unsigned long seed_;
+
+    // made when it's needed, and again when the options change
+    std::unique_ptr<Renderer> renderer_;
+    RenderCache cache_;
+
+    // the same, for PPM_renderChanges
+    std::unique_ptr<RenderSession> session_;
+
+    // a result that didn't fit in its buffer
+    std::string pendingInput_;
+    std::string pendingResult_;
+    bool hasPending_;
+
+    std::string error_;
+
+    bool profiling_;
+    Profile profile_;
+    std::string profileJson_;
+};
+
+#endif
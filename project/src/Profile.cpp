@@ -0,0 +1,226 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <iomanip>
+
+#include "Profile.h"
+
+thread_local Profile *Profile::current = NULL;
+
+const char *Profile::getPhaseName(Phase phase)
+{
+    static const char *names[] = {
+        "other",
+        "start",
+        "parse",
+        "evaluate",
+        "layout",
+        "renderText",
+        "renderNested",
+        "renderDivide",
+        "renderRaise",
+        "renderArithmetic",
+        "renderCall",
+        "renderAssignment",
+        "renderFunctionUpdate",
+        "draw",
+        "encode"
+    };
+
+    static_assert(sizeof(names) / sizeof(names[0]) == PHASE_COUNT,
+                  "every phase needs a name");
+
+    return names[phase];
+}
+
+const char *Profile::getCounterName(Counter counter)
+{
+    static const char *names[] = {
+        "renders",
+        "cacheHits",
+        "memoHits",
+        "blits",
+        "grows",
+        "outputBytes"
+    };
+
+    static_assert(sizeof(names) / sizeof(names[0]) == COUNTER_COUNT,
+                  "every counter needs a name");
+
+    return names[counter];
+}
+
+void Profile::count(Counter counter, unsigned long amount)
+{
+    if (current != NULL)
+    {
+        current->counts_[counter] += amount;
+    }
+}
+
+Profile::Scope::Scope(Phase phase)
+    : profile_(Profile::current),
+      previous_(PHASE_OTHER)
+{
+    if (profile_ != NULL)
+    {
+        previous_ = profile_->enter(phase);
+    }
+}
+
+Profile::Scope::~Scope()
+{
+    if (profile_ != NULL)
+    {
+        profile_->enter(previous_);
+    }
+}
+
+Profile::Recorder::Recorder(Profile *profile)
+    : profile_(profile),
+      previous_(Profile::current)
+{
+    if (profile_ != NULL)
+    {
+        profile_->since_ = std::chrono::steady_clock::now();
+    }
+
+    Profile::current = profile_;
+}
+
+Profile::Recorder::~Recorder()
+{
+    if (profile_ != NULL)
+    {
+        profile_->enter(profile_->phase_);
+    }
+
+    Profile::current = previous_;
+}
+
+Profile::Profile()
+{
+    clear();
+}
+
+Profile::~Profile()
+{
+}
+
+void Profile::clear()
+{
+    nanoseconds_.fill(0);
+    counts_.fill(0);
+    phase_ = PHASE_OTHER;
+    since_ = std::chrono::steady_clock::now();
+}
+
+uint64_t Profile::getNanoseconds(Phase phase) const
+{
+    return nanoseconds_[phase];
+}
+
+unsigned long Profile::getCount(Counter counter) const
+{
+    return counts_[counter];
+}
+
+void Profile::add(const Profile &other)
+{
+    for (size_t i = 0; i < PHASE_COUNT; i++)
+    {
+        nanoseconds_[i] += other.nanoseconds_[i];
+    }
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        counts_[i] += other.counts_[i];
+    }
+}
+
+void Profile::write(std::ostream &out) const
+{
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    uint64_t total = 0;
+
+    for (uint64_t nanoseconds : nanoseconds_)
+    {
+        total += nanoseconds;
+    }
+
+    out << std::left << std::setw(24) << "phase"
+        << std::right << std::setw(12) << "ms"
+        << std::setw(8) << "%" << "\n";
+
+    for (size_t i = 0; i < PHASE_COUNT; i++)
+    {
+        out << std::left << std::setw(24) << getPhaseName((Phase)i)
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << nanoseconds_[i] / 1e6
+            << std::setprecision(1)
+            << std::setw(8) << (total > 0 ? 100.0 * nanoseconds_[i] / total : 0.0)
+            << "\n";
+    }
+
+    out << "\n"
+        << std::left << std::setw(24) << "counter"
+        << std::right << std::setw(12) << "count" << "\n";
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        out << std::left << std::setw(24) << getCounterName((Counter)i)
+            << std::right << std::setw(12) << counts_[i] << "\n";
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void Profile::writeJson(std::ostream &out) const
+{
+    out << "{\"nanoseconds\": {";
+
+    for (size_t i = 0; i < PHASE_COUNT; i++)
+    {
+        out << (i > 0 ? ", " : "")
+            << "\"" << getPhaseName((Phase)i) << "\": " << nanoseconds_[i];
+    }
+
+    out << "}, \"counts\": {";
+
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        out << (i > 0 ? ", " : "")
+            << "\"" << getCounterName((Counter)i) << "\": " << counts_[i];
+    }
+
+    out << "}}";
+}
+
+Profile::Phase Profile::enter(Phase phase)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const Phase result = phase_;
+
+    nanoseconds_[phase_] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - since_).count();
+    since_ = now;
+    phase_ = phase;
+
+    return result;
+}
@@ -0,0 +1,179 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A Profile adds up how long each phase of rendering takes, and counts
+// what the renders did
+//
+// A thread only records into a Profile when it has one, see 'current', so
+// profiling costs a test of a pointer when it's off
+//
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+class Profile
+{
+public:
+    enum Phase
+    {
+        // the time between the other phases
+        PHASE_OTHER,
+
+        // starting Taffy
+        PHASE_START,
+
+        // parsing with MathParser
+        PHASE_PARSE,
+
+        // parsing with Taffy
+        PHASE_EVALUATE,
+
+        // laying out, outside of the nodes
+        PHASE_LAYOUT,
+
+        // laying out each kind of node, in the order of MathNode::Kind
+        PHASE_RENDER_TEXT,
+        PHASE_RENDER_NESTED,
+        PHASE_RENDER_DIVIDE,
+        PHASE_RENDER_RAISE,
+        PHASE_RENDER_ARITHMETIC,
+        PHASE_RENDER_CALL,
+        PHASE_RENDER_ASSIGNMENT,
+        PHASE_RENDER_FUNCTION_UPDATE,
+
+        // drawing the layout into a lattice
+        PHASE_DRAW,
+
+        // encoding into text
+        PHASE_ENCODE,
+
+        // how many phases there are
+        PHASE_COUNT
+    };
+
+    enum Counter
+    {
+        COUNTER_RENDERS,
+
+        // renders found in the render cache
+        COUNTER_CACHE_HITS,
+
+        // subtrees copied from an earlier render of them
+        COUNTER_MEMO_HITS,
+
+        // lattices copied into another one
+        COUNTER_BLITS,
+
+        // lattices that had to reallocate to grow
+        COUNTER_GROWS,
+
+        // the bytes of text rendered
+        COUNTER_OUTPUT_BYTES,
+
+        // how many counters there are
+        COUNTER_COUNT
+    };
+
+    // short names, like: layout, or: cacheHits
+    static const char *getPhaseName(Phase phase);
+    static const char *getCounterName(Counter counter);
+
+    // the profile that this thread records into, or NULL
+    static thread_local Profile *current;
+
+    // add 'amount' to 'counter' of the thread's profile, if it has one
+    static void count(Counter counter, unsigned long amount = 1);
+
+    //
+    // a Scope puts the thread's profile in a phase until it's destroyed.
+    // scopes nest, and the time spent in an inner one isn't counted in the
+    // outer one
+    //
+    class Scope
+    {
+    public:
+        Scope(Phase phase);
+        ~Scope();
+
+        // can't copy
+        Scope(const Scope &other) = delete;
+        Scope &operator=(const Scope &other) = delete;
+
+    protected:
+        Profile *profile_;
+        Phase previous_;
+    };
+
+    //
+    // a Recorder makes 'profile' the thread's profile until it's destroyed,
+    // then puts back the one before. only the time in between is counted
+    //
+    class Recorder
+    {
+    public:
+        Recorder(Profile *profile);
+        ~Recorder();
+
+        // can't copy
+        Recorder(const Recorder &other) = delete;
+        Recorder &operator=(const Recorder &other) = delete;
+
+    protected:
+        Profile *profile_;
+        Profile *previous_;
+    };
+
+    Profile();
+    virtual ~Profile();
+
+    // forget everything, and start timing from now
+    void clear();
+
+    // the time spent in 'phase', counting up to the last phase change
+    uint64_t getNanoseconds(Phase phase) const;
+
+    unsigned long getCount(Counter counter) const;
+
+    // add the times and counts of 'other', like from another thread
+    void add(const Profile &other);
+
+    // a table of the phases and counters, for people
+    void write(std::ostream &out) const;
+
+    // the same, as a JSON object like:
+    // {"nanoseconds": {"other": 120, ...}, "counts": {"renders": 1, ...}}
+    void writeJson(std::ostream &out) const;
+
+protected:
+    // charge the time since the last change to the phase we're in, and
+    // move to 'phase'
+    // returns the phase we were in
+    Phase enter(Phase phase);
+
+    std::array<uint64_t, PHASE_COUNT> nanoseconds_;
+    std::array<unsigned long, COUNTER_COUNT> counts_;
+    Phase phase_;
+    std::chrono::steady_clock::time_point since_;
+};
+
+#endif
@@ -0,0 +1,145 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <functional>
+
+#include "RenderCache.h"
+
+bool RenderCache::Key::operator==(const Key &other) const
+{
+    return (font == other.font
+            && colorMode == other.colorMode
+            && spacing == other.spacing
+            && maths == other.maths);
+}
+
+size_t RenderCache::KeyHash::operator()(const Key &key) const
+{
+    size_t result = std::hash<std::string>()(key.maths);
+
+    for (size_t value : {std::hash<const Font *>()(key.font),
+                         std::hash<int>()(key.colorMode),
+                         std::hash<int>()(key.spacing)})
+    {
+        result ^= value + 0x9e3779b9 + (result << 6) + (result >> 2);
+    }
+
+    return result;
+}
+
+RenderCache::RenderCache(size_t capacity)
+    : capacity_(capacity),
+      hits_(0),
+      misses_(0)
+{
+}
+
+RenderCache::~RenderCache()
+{
+}
+
+std::shared_ptr<const Lattice> RenderCache::find(const Key &key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found = index_.find(key);
+
+    if (found == index_.end())
+    {
+        misses_++;
+        return nullptr;
+    }
+
+    hits_++;
+
+    // it's now the most recently used
+    entries_.splice(entries_.begin(), entries_, found->second);
+    return found->second->second;
+}
+
+void RenderCache::insert(const Key &key, const std::shared_ptr<const Lattice> &lattice)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (capacity_ == 0)
+    {
+        return;
+    }
+
+    const auto found = index_.find(key);
+
+    if (found != index_.end())
+    {
+        // another thread got here first
+        found->second->second = lattice;
+        entries_.splice(entries_.begin(), entries_, found->second);
+        return;
+    }
+
+    entries_.push_front(std::make_pair(key, lattice));
+    index_[key] = entries_.begin();
+    trim();
+}
+
+void RenderCache::trim()
+{
+    while (entries_.size() > capacity_)
+    {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+}
+
+void RenderCache::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    trim();
+}
+
+size_t RenderCache::getCapacity() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+size_t RenderCache::getSize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+unsigned long RenderCache::getHits() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+unsigned long RenderCache::getMisses() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+void RenderCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    hits_ = 0;
+    misses_ = 0;
+}
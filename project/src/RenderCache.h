@@ -0,0 +1,98 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A RenderCache holds the most recently rendered Lattices, so rendering the
+// same input again only has to color it
+//
+// It's bounded, dropping the least recently used Lattice when it's full,
+// and it's safe to use from many threads
+//
+#ifndef __RENDER_CACHE_H__
+#define __RENDER_CACHE_H__
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Font.h"
+#include "Lattice.h"
+
+class RenderCache
+{
+public:
+    // everything a render's characters and ids depend on
+    struct Key
+    {
+        bool operator==(const Key &other) const;
+
+        std::string maths;
+        const Font *font;
+        int colorMode;
+        int spacing;
+    };
+
+    RenderCache(size_t capacity = 1024);
+    virtual ~RenderCache();
+
+    // can't copy
+    RenderCache(const RenderCache &other) = delete;
+    RenderCache &operator=(const RenderCache &other) = delete;
+
+    // the Lattice for 'key', or nullptr if there isn't one
+    std::shared_ptr<const Lattice> find(const Key &key);
+
+    void insert(const Key &key, const std::shared_ptr<const Lattice> &lattice);
+
+    // a capacity of 0 turns the cache off
+    void setCapacity(size_t capacity);
+    size_t getCapacity() const;
+    size_t getSize() const;
+
+    // how many finds found something, and how many didn't
+    unsigned long getHits() const;
+    unsigned long getMisses() const;
+
+    void clear();
+
+protected:
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    typedef std::pair<Key, std::shared_ptr<const Lattice>> Entry;
+
+    // drop the least recently used entries until there's no more than
+    // 'capacity_'
+    void trim();
+
+    // the most recently used entry is first
+    std::list<Entry> entries_;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+
+    size_t capacity_;
+    unsigned long hits_;
+    unsigned long misses_;
+
+    mutable std::mutex mutex_;
+};
+
+#endif
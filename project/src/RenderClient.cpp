@@ -0,0 +1,71 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "RenderClient.h"
+
+RenderClient::RenderClient(const std::string &path)
+    : socket_(-1)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (path.length() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error(std::string("socket path is too long: ") + path);
+    }
+
+    strcpy(address.sun_path, path.c_str());
+    socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (socket_ < 0
+        || connect(socket_, (const sockaddr *)&address, sizeof(address)) != 0)
+    {
+        const std::string error = strerror(errno);
+
+        if (socket_ >= 0)
+        {
+            close(socket_);
+        }
+
+        throw std::runtime_error(std::string("can't connect to ") + path + ": " + error);
+    }
+
+    // a server that goes away is an error, not a signal
+    signal(SIGPIPE, SIG_IGN);
+}
+
+RenderClient::~RenderClient()
+{
+    close(socket_);
+}
+
+RenderResponse RenderClient::render(const RenderRequest &request)
+{
+    RenderProtocol::writeRequest(socket_, request);
+    return RenderProtocol::readResponse(socket_);
+}
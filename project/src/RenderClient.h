@@ -0,0 +1,48 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A RenderClient asks a RenderServer to render, see RenderProtocol.h
+//
+#ifndef __RENDER_CLIENT_H__
+#define __RENDER_CLIENT_H__
+
+#include <string>
+
+#include "RenderProtocol.h"
+
+class RenderClient
+{
+public:
+    // connect to the server at 'path'
+    // throws std::runtime_error
+    RenderClient(const std::string &path);
+    virtual ~RenderClient();
+
+    // can't copy
+    RenderClient(const RenderClient &other) = delete;
+    RenderClient &operator=(const RenderClient &other) = delete;
+
+    // throws std::runtime_error if the connection fails
+    RenderResponse render(const RenderRequest &request);
+
+protected:
+    int socket_;
+};
+
+#endif
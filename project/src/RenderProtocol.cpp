@@ -0,0 +1,186 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "RenderProtocol.h"
+
+void RenderProtocol::writeFrame(int socket, const std::string &frame)
+{
+    if (frame.length() > maxFrameLength)
+    {
+        throw std::runtime_error("message is too long");
+    }
+
+    const uint32_t length = htonl((uint32_t)frame.length());
+    std::string buffer((const char *)&length, sizeof(length));
+    buffer += frame;
+
+    for (size_t written = 0; written < buffer.length();)
+    {
+        const ssize_t result = write(socket,
+                                     buffer.data() + written,
+                                     buffer.length() - written);
+
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (result <= 0)
+        {
+            throw std::runtime_error(std::string("can't write to socket: ")
+                                     + strerror(errno));
+        }
+
+        written += result;
+    }
+}
+
+bool RenderProtocol::readFully(int socket, char *buffer, size_t length)
+{
+    for (size_t done = 0; done < length;)
+    {
+        const ssize_t result = read(socket, buffer + done, length - done);
+
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (result < 0)
+        {
+            throw std::runtime_error(std::string("can't read from socket: ")
+                                     + strerror(errno));
+        }
+        else if (result == 0)
+        {
+            if (done == 0)
+            {
+                return false;
+            }
+
+            throw std::runtime_error("connection closed in the middle of a message");
+        }
+
+        done += result;
+    }
+
+    return true;
+}
+
+bool RenderProtocol::readFrame(int socket, std::string &frame)
+{
+    uint32_t length;
+
+    if (! readFully(socket, (char *)&length, sizeof(length)))
+    {
+        return false;
+    }
+
+    length = ntohl(length);
+
+    if (length > maxFrameLength)
+    {
+        throw std::runtime_error("message is too long");
+    }
+
+    frame.resize(length);
+
+    if (length > 0 && ! readFully(socket, &frame[0], length))
+    {
+        throw std::runtime_error("connection closed in the middle of a message");
+    }
+
+    return true;
+}
+
+void RenderProtocol::writeRequest(int socket, const RenderRequest &request)
+{
+    std::string frame;
+
+    for (const std::string *field : {&request.fontType,
+                                     &request.colorMode,
+                                     &request.palette})
+    {
+        frame += *field;
+        frame += '\0';
+    }
+
+    frame += (request.randomColors ? '1' : '0');
+    frame += '\0';
+    frame += request.input;
+    writeFrame(socket, frame);
+}
+
+bool RenderProtocol::readRequest(int socket, RenderRequest &request)
+{
+    std::string frame;
+
+    if (! readFrame(socket, frame))
+    {
+        return false;
+    }
+
+    std::string random;
+    size_t start = 0;
+
+    for (std::string *field : {&request.fontType,
+                               &request.colorMode,
+                               &request.palette,
+                               &random})
+    {
+        const size_t end = frame.find('\0', start);
+
+        if (end == std::string::npos)
+        {
+            throw std::runtime_error("malformed request");
+        }
+
+        *field = frame.substr(start, end - start);
+        start = end + 1;
+    }
+
+    request.randomColors = (random == "1");
+    request.input = frame.substr(start);
+    return true;
+}
+
+void RenderProtocol::writeResponse(int socket, const RenderResponse &response)
+{
+    writeFrame(socket, (response.success ? "0" : "1") + response.text);
+}
+
+RenderResponse RenderProtocol::readResponse(int socket)
+{
+    std::string frame;
+
+    if (! readFrame(socket, frame) || frame.empty())
+    {
+        throw std::runtime_error("the server closed the connection");
+    }
+
+    RenderResponse response;
+    response.success = (frame[0] == '0');
+    response.text = frame.substr(1);
+    return response;
+}
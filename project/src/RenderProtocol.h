@@ -0,0 +1,75 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// The protocol ppm --serve speaks over its Unix domain socket
+//
+// Every message is a frame: a 4 byte length in network byte order, then
+// that many bytes. A request's bytes are its font, color mode, palette,
+// random flag ('0' or '1') and input, separated by NULs. A response's bytes
+// are a status ('0' for success, '1' for an error) followed by the rendered
+// text, or the error message. A connection can carry any number of
+// requests, each answered in turn.
+//
+#ifndef __RENDER_PROTOCOL_H__
+#define __RENDER_PROTOCOL_H__
+
+#include <cstdint>
+#include <string>
+
+struct RenderRequest
+{
+    std::string fontType;
+    std::string colorMode;
+    std::string palette;
+    bool randomColors;
+    std::string input;
+};
+
+struct RenderResponse
+{
+    bool success;
+    std::string text;
+};
+
+class RenderProtocol
+{
+public:
+    // the largest frame that's accepted
+    static const uint32_t maxFrameLength = 16 * 1024 * 1024;
+
+    // throw std::runtime_error
+    static void writeRequest(int socket, const RenderRequest &request);
+    static void writeResponse(int socket, const RenderResponse &response);
+    static RenderResponse readResponse(int socket);
+
+    // returns false if the other end closed the connection between requests
+    // throws std::runtime_error
+    static bool readRequest(int socket, RenderRequest &request);
+
+protected:
+    static void writeFrame(int socket, const std::string &frame);
+
+    // returns false if the connection closed before the frame began
+    static bool readFrame(int socket, std::string &frame);
+
+    // returns false if the connection closed before anything was read
+    static bool readFully(int socket, char *buffer, size_t length);
+};
+
+#endif
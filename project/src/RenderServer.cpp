@@ -0,0 +1,261 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "FontFactory.h"
+#include "RenderProtocol.h"
+#include "RenderServer.h"
+#include "Renderer.h"
+#include "TaffyBridge.h"
+
+// set when it's time to stop serving
+static volatile sig_atomic_t sStopping = 0;
+
+static void stopServing(int)
+{
+    sStopping = 1;
+}
+
+// the address of the socket at 'path'
+static sockaddr_un getAddress(const std::string &path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (path.length() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error(std::string("socket path is too long: ") + path);
+    }
+
+    strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+RenderServer::RenderServer(const std::string &path, RenderCache &cache)
+    : path_(path),
+      cache_(cache),
+      socket_(-1)
+{
+}
+
+RenderServer::~RenderServer()
+{
+    if (socket_ >= 0)
+    {
+        close(socket_);
+        unlink(path_.c_str());
+    }
+}
+
+void RenderServer::listen()
+{
+    const sockaddr_un address = getAddress(path_);
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (probe < 0)
+    {
+        throw std::runtime_error(std::string("can't create socket: ") + strerror(errno));
+    }
+
+    // don't take the socket of a server that's still running, but replace
+    // one that's been left behind
+    const bool running = (connect(probe, (const sockaddr *)&address, sizeof(address)) == 0);
+    close(probe);
+
+    if (running)
+    {
+        throw std::runtime_error(std::string("a server is already running on: ") + path_);
+    }
+
+    unlink(path_.c_str());
+    socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (socket_ < 0
+        || bind(socket_, (const sockaddr *)&address, sizeof(address)) != 0
+        || ::listen(socket_, SOMAXCONN) != 0)
+    {
+        const std::string error = strerror(errno);
+
+        if (socket_ >= 0)
+        {
+            close(socket_);
+            socket_ = -1;
+        }
+
+        throw std::runtime_error(std::string("can't listen on ") + path_ + ": " + error);
+    }
+}
+
+void RenderServer::serve()
+{
+    // warm up before taking requests, including Taffy, which isn't
+    // otherwise started until something needs it
+    TaffyBridge::getInstance().start();
+    FontFactory::getInstance().createFont("small");
+
+    listen();
+
+    // stop on SIGINT and SIGTERM
+    signal(SIGINT, &stopServing);
+    signal(SIGTERM, &stopServing);
+
+    // a client that goes away shouldn't take us with it
+    signal(SIGPIPE, SIG_IGN);
+
+    while (! sStopping)
+    {
+        // any thread can get the signal, so check for it now and then
+        // instead of relying on it to interrupt us
+        pollfd listening = {socket_, POLLIN, 0};
+
+        if (poll(&listening, 1, 250) <= 0)
+        {
+            continue;
+        }
+
+        const int client = accept(socket_, NULL, NULL);
+
+        if (client < 0)
+        {
+            if (errno != EINTR)
+            {
+                std::cerr << "Error: can't accept connection: " << strerror(errno) << "\n";
+            }
+
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+
+        // forget the connections that are done
+        for (auto connection = connections_.begin(); connection != connections_.end();)
+        {
+            if (connection->socket < 0)
+            {
+                connection->thread.join();
+                connection = connections_.erase(connection);
+            }
+            else
+            {
+                connection++;
+            }
+        }
+
+        connections_.push_back(Connection());
+        Connection &connection = connections_.back();
+        connection.socket = client;
+        connection.thread = std::thread([this, client, &connection] {
+                answer(client);
+
+                std::lock_guard<std::mutex> threadLock(connectionsMutex_);
+                close(connection.socket);
+                connection.socket = -1;
+            });
+    }
+
+    // wake up the connections that are waiting for requests, and wait for
+    // them to finish
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+
+        for (Connection &connection : connections_)
+        {
+            if (connection.socket >= 0)
+            {
+                shutdown(connection.socket, SHUT_RDWR);
+            }
+        }
+    }
+
+    for (Connection &connection : connections_)
+    {
+        connection.thread.join();
+    }
+
+    connections_.clear();
+}
+
+void RenderServer::answer(int socket)
+{
+    // a renderer for each set of options the client has used
+    std::map<std::string, std::unique_ptr<Renderer>> renderers;
+    RenderRequest request;
+
+    try
+    {
+        while (RenderProtocol::readRequest(socket, request))
+        {
+            RenderResponse response = {true, ""};
+
+            try
+            {
+                const std::string key = (request.fontType + '\0'
+                                         + request.colorMode + '\0'
+                                         + request.palette + '\0'
+                                         + (request.randomColors ? '1' : '0'));
+                std::unique_ptr<Renderer> &renderer = renderers[key];
+
+                if (renderer == nullptr)
+                {
+                    Font *font = FontFactory::getInstance().createFont(request.fontType);
+                    renderer.reset(new Renderer(font,
+                                                Renderer::getColorMode(request.colorMode),
+                                                request.randomColors,
+                                                AnsiEncoder::getPalette(request.palette)));
+                    renderer->setCache(&cache_);
+                }
+
+                response.text = renderer->render(request.input);
+            }
+            catch (std::exception &exception)
+            {
+                response = {false, exception.what()};
+            }
+
+            // the status takes a byte of the frame. a result that won't fit
+            // is the request's fault, so the connection can carry on
+            if (response.text.length() + 1 > RenderProtocol::maxFrameLength)
+            {
+                response = {false, "result is too long"};
+            }
+
+            RenderProtocol::writeResponse(socket, response);
+        }
+    }
+    catch (std::exception &exception)
+    {
+        // the connection is broken, so give up on it
+        if (! sStopping)
+        {
+            std::cerr << "Error: " << exception.what() << "\n";
+        }
+    }
+}
@@ -0,0 +1,71 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A RenderServer answers render requests on a Unix domain socket, keeping
+// Taffy, the fonts and its render cache warm between them
+//
+// Each connection gets a thread of its own. The server runs until it's
+// interrupted or terminated
+//
+#ifndef __RENDER_SERVER_H__
+#define __RENDER_SERVER_H__
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "RenderCache.h"
+
+class RenderServer
+{
+public:
+    RenderServer(const std::string &path, RenderCache &cache);
+    virtual ~RenderServer();
+
+    // can't copy
+    RenderServer(const RenderServer &other) = delete;
+    RenderServer &operator=(const RenderServer &other) = delete;
+
+    // listen and answer requests until a SIGINT or SIGTERM
+    // throws std::runtime_error if the socket can't be set up
+    void serve();
+
+protected:
+    struct Connection
+    {
+        int socket;
+        std::thread thread;
+    };
+
+    // answer the requests of one connection until it closes
+    void answer(int socket);
+
+    // open 'path_' for listening into 'socket_'
+    void listen();
+
+    std::string path_;
+    RenderCache &cache_;
+    int socket_;
+
+    std::list<Connection> connections_;
+    std::mutex connectionsMutex_;
+};
+
+#endif
@@ -0,0 +1,85 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+
+#include "RenderSession.h"
+
+RenderSession::RenderSession(Font *font,
+                             Renderer::ColorMode colorMode,
+                             bool randomColors,
+                             AnsiEncoder::Palette palette)
+    : renderer_(font, colorMode, randomColors, palette)
+{
+    renderer_.setSteadyColors(true);
+}
+
+RenderSession::~RenderSession()
+{
+}
+
+size_t RenderSession::render(const std::string &maths, const RowSink &sink)
+{
+    text_.clear();
+
+    try
+    {
+        renderer_.render(maths, [this](const char *text, size_t length) {
+                text_.append(text, length);
+            });
+    }
+    catch (...)
+    {
+        // whatever's showing now isn't the last render
+        rows_.clear();
+        throw;
+    }
+
+    size_t row = 0;
+
+    for (size_t begin = 0; begin < text_.length(); row++)
+    {
+        const size_t end = std::min(text_.find('\n', begin), text_.length());
+
+        if (row >= rows_.size())
+        {
+            rows_.emplace_back(text_, begin, end - begin);
+            sink(row, rows_[row]);
+        }
+        else if (rows_[row].compare(0, std::string::npos, text_, begin, end - begin) != 0)
+        {
+            rows_[row].assign(text_, begin, end - begin);
+            sink(row, rows_[row]);
+        }
+
+        begin = end + 1;
+    }
+
+    rows_.resize(row);
+    return row;
+}
+
+void RenderSession::clear()
+{
+    rows_.clear();
+}
+
+Renderer &RenderSession::getRenderer()
+{
+    return renderer_;
+}
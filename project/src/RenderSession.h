@@ -0,0 +1,77 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// A RenderSession renders one formula again and again as it's edited, like
+// for a live preview, and hands back only the rows of text that changed
+//
+// Its renderer keeps the same colors from one render to the next, and the
+// layouts of the subtrees it has seen before, so a render only lays out
+// what's new and what's around it
+//
+#ifndef __RENDER_SESSION_H__
+#define __RENDER_SESSION_H__
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "AnsiEncoder.h"
+#include "Font.h"
+#include "Renderer.h"
+
+class RenderSession
+{
+public:
+    // gets each row that changed, by its number from the top
+    typedef std::function<void (size_t row, const std::string &text)> RowSink;
+
+    RenderSession(Font *font,
+                  Renderer::ColorMode colorMode,
+                  bool randomColors = true,
+                  AnsiEncoder::Palette palette = AnsiEncoder::PALETTE_BASIC);
+    virtual ~RenderSession();
+
+    // can't copy
+    RenderSession(const RenderSession &other) = delete;
+    RenderSession &operator=(const RenderSession &other) = delete;
+
+    // render 'maths', passing 'sink' each row that's different from the
+    // last render's, in order. rows past the end of the last render are
+    // always different
+    // returns the number of rows
+    // throws std::runtime_error
+    size_t render(const std::string &maths, const RowSink &sink);
+
+    // forget the last render's rows, so the next render passes every row
+    void clear();
+
+    // for setting the cache and seed
+    Renderer &getRenderer();
+
+protected:
+    Renderer renderer_;
+
+    // the last render's rows
+    std::vector<std::string> rows_;
+
+    // the text of a render, kept between renders
+    std::string text_;
+};
+
+#endif
@@ -23,14 +23,42 @@
 #include <algorithm>
 #include <list>
 
-#include "dcTaffy.h"
-
+#include "MathParser.h"
+#include "Profile.h"
 #include "Renderer.h"
 #include "TaffyBridge.h"
 
+// how many shapes are kept before starting over
+static const size_t maxShapes = 64 * 1024;
+
+// how many memos are kept before starting over
+static const size_t maxMemos = 1024;
+
+bool Renderer::Shape::operator==(const Shape &other) const
+{
+    return (kind == other.kind
+            && grouped == other.grouped
+            && text == other.text
+            && children == other.children);
+}
+
+size_t Renderer::ShapeHash::operator()(const Shape &shape) const
+{
+    size_t result = std::hash<std::string>()(shape.text);
+
+    result ^= (shape.kind << 1 | shape.grouped) + 0x9e3779b9 + (result << 6) + (result >> 2);
+
+    for (unsigned int child : shape.children)
+    {
+        result ^= child + 0x9e3779b9 + (result << 6) + (result >> 2);
+    }
+
+    return result;
+}
+
 Renderer::ColorMode Renderer::getColorMode(std::string input)
 {
-    const std::unordered_map<std::string, Renderer::ColorMode> lookup = {
+    static const std::unordered_map<std::string, Renderer::ColorMode> lookup = {
         {"",            COLOR_MODE_NONE},
         {"none",        COLOR_MODE_NONE},
         {"alternating", COLOR_MODE_ALTERNATING},
@@ -49,11 +77,25 @@ Renderer::ColorMode Renderer::getColorMode(std::string input)
     return found->second;
 }
 
-Renderer::Renderer(Font *font, ColorMode colorMode, bool randomColors, int defaultSpacing)
+Renderer::Renderer(Font *font,
+                   ColorMode colorMode,
+                   bool randomColors,
+                   AnsiEncoder::Palette palette,
+                   int defaultSpacing)
     : font_(font),
       colorMode_(colorMode),
       randomColors_(randomColors),
-      defaultSpacing_(defaultSpacing)
+      encoder_((colorMode == COLOR_MODE_NONE
+                ? AnsiEncoder::PALETTE_NONE
+                : palette),
+               randomColors),
+      steadyColors_(false),
+      shuffled_(false),
+      defaultSpacing_(defaultSpacing),
+      cache_(NULL),
+      arena_(std::pmr::get_default_resource()),
+      arenaBuffer_(64 * 1024),
+      parentCount_(0)
 {
 }
 
@@ -61,12 +103,63 @@ Renderer::~Renderer()
 {
 }
 
-// The main entry point for Renderer
-std::string Renderer::render(const std::string &maths)
+void Renderer::setCache(RenderCache *cache)
+{
+    cache_ = cache;
+}
+
+void Renderer::setSeed(unsigned long seed)
+{
+    encoder_.setSeed(seed);
+    shuffled_ = false;
+}
+
+void Renderer::setSteadyColors(bool steadyColors)
 {
+    steadyColors_ = steadyColors;
+}
+
+void Renderer::shuffle()
+{
+    // each render gets its own colors, unless they're steady
+    if (! steadyColors_ || ! shuffled_)
+    {
+        encoder_.shuffle();
+        shuffled_ = true;
+    }
+}
+
+template <typename Use>
+void Renderer::layout(const std::string &maths, Use use)
+{
+    // start every render with the same ids, so its colors don't depend on
+    // what was rendered before
+    Lattice::currentId = 0;
+
+    // every Box below is released with the arena, so nothing that outlives
+    // the layout can come from it
+    std::pmr::monotonic_buffer_resource arena(arenaBuffer_.data(), arenaBuffer_.size());
+
+    // point 'arena_' at the arena until it's gone, even if the layout throws
+    struct ArenaScope
+    {
+        ArenaScope(Renderer &inRenderer, std::pmr::memory_resource *resource)
+            : renderer(inRenderer)
+        {
+            renderer.arena_ = resource;
+        }
+
+        ~ArenaScope()
+        {
+            renderer.arena_ = std::pmr::get_default_resource();
+        }
+
+        Renderer &renderer;
+    } arenaScope(*this, &arena);
+
     // an assignment won't always be parsible by Taffy -- think: y^2 = x
     // so treat assignments (and equalities) as a special case
-    LatticePtr graph = tryToRenderAssignment(maths);
+    BoxPtr graph = tryToRenderAssignment(maths);
 
     if (graph == NULL)
     {
@@ -74,50 +167,230 @@ std::string Renderer::render(const std::string &maths)
         graph = compileAndRenderString(maths);
     }
 
-    return graph.get()->convertToString(colorMode_ != COLOR_MODE_NONE, randomColors_);
+    use(*graph);
+}
+
+// The main entry point for Renderer
+std::string Renderer::render(const std::string &maths)
+{
+    std::shared_ptr<const Lattice> lattice;
+    const RenderCache::Key key = {maths, font_, colorMode_, defaultSpacing_};
+
+    if (cache_ != NULL)
+    {
+        lattice = cache_->find(key);
+    }
+
+    if (lattice == nullptr)
+    {
+        Profile::Scope scope(Profile::PHASE_LAYOUT);
+        lattice = layout(maths);
+
+        if (cache_ != NULL)
+        {
+            cache_->insert(key, lattice);
+        }
+    }
+    else
+    {
+        Profile::count(Profile::COUNTER_CACHE_HITS);
+    }
+
+    Profile::Scope scope(Profile::PHASE_ENCODE);
+
+    shuffle();
+    std::string result = encoder_.encode(*lattice);
+
+    Profile::count(Profile::COUNTER_RENDERS);
+    Profile::count(Profile::COUNTER_OUTPUT_BYTES, result.length());
+
+    return result;
 }
 
-LatticePtr Renderer::renderDivideBar(LatticePtr &top, LatticePtr &bottom)
+size_t Renderer::render(const std::string &maths, const Sink &sink)
 {
-    LatticePtr result = std::unique_ptr<Lattice>(new Lattice());
-    const StringVector *fancy = font_->get('-');
+    std::shared_ptr<const Lattice> lattice;
+    const RenderCache::Key key = {maths, font_, colorMode_, defaultSpacing_};
+    size_t result = 0;
+
+    if (cache_ != NULL)
+    {
+        lattice = cache_->find(key);
+    }
+
+    shuffle();
+
+    if (lattice == nullptr)
+    {
+        Profile::Scope scope(Profile::PHASE_LAYOUT);
+
+        layout(maths, [this, &lattice, &result, &sink](const Box &graph) {
+                if (graph.getWidth() * graph.getHeight() <= bandSize)
+                {
+                    Profile::Scope drawScope(Profile::PHASE_DRAW);
+                    lattice = graph.draw();
+                }
+                else
+                {
+                    result = stream(graph, sink);
+                }
+            });
+
+        if (lattice != nullptr && cache_ != NULL)
+        {
+            cache_->insert(key, lattice);
+        }
+    }
+    else
+    {
+        Profile::count(Profile::COUNTER_CACHE_HITS);
+    }
 
-    if (fancy == NULL)
+    if (lattice != nullptr)
     {
-        return result;
+        result = stream(*lattice, sink);
     }
 
-    Lattice bar(*fancy, '-');
-    bar.removeBlankLines();
+    Profile::count(Profile::COUNTER_RENDERS);
+    Profile::count(Profile::COUNTER_OUTPUT_BYTES, result);
+
+    return result;
+}
+
+std::shared_ptr<const Lattice> Renderer::layout(const std::string &maths)
+{
+    std::shared_ptr<const Lattice> result;
+
+    // the layout is done, so draw it
+    layout(maths, [&result](const Box &graph) {
+            Profile::Scope scope(Profile::PHASE_DRAW);
+            result = graph.draw();
+        });
 
-    while (result->getWidth() <= std::max(top->getWidth(), bottom->getWidth()))
+    return result;
+}
+
+size_t Renderer::getBandHeight(size_t width)
+{
+    return std::max(bandSize / std::max(width, (size_t)1), (size_t)1);
+}
+
+size_t Renderer::stream(const Lattice &lattice, const Sink &sink)
+{
+    const size_t height = lattice.getHeight();
+    const size_t bandHeight = getBandHeight(lattice.getWidth());
+    std::string text;
+    size_t result = 0;
+
+    for (size_t top = 0; top < height; top += bandHeight)
     {
-        result->addToRightSquished(bar);
+        Profile::Scope scope(Profile::PHASE_ENCODE);
+        encoder_.encode(lattice, top, std::min(bandHeight, height - top), text);
 
-        if (colorMode_ == COLOR_MODE_ALTERNATING)
+        if (top > 0)
         {
-            bar.setNewId();
+            sink("\n", 1);
+            result++;
         }
+
+        sink(text.data(), text.length());
+        result += text.length();
     }
 
     return result;
 }
 
-LatticePtr Renderer::renderString(const std::string &maths)
+size_t Renderer::stream(const Box &graph, const Sink &sink)
 {
-    LatticePtr result = std::unique_ptr<Lattice>(new Lattice());
-    char previousValue = 0;
+    const size_t height = graph.getHeight();
+    const size_t bandHeight = getBandHeight(graph.getWidth());
+    std::string text;
+    size_t result = 0;
 
-    for (char value : maths)
+    for (size_t top = 0; top < height; top += bandHeight)
     {
-        const StringVector *fancy = font_->get(value);
+        const size_t rows = std::min(bandHeight, height - top);
+        std::unique_ptr<Lattice> band;
 
-        if (fancy == NULL)
         {
-            fancy = font_->get('?');
+            Profile::Scope scope(Profile::PHASE_DRAW);
+            band = graph.draw(top, rows);
         }
 
-        Lattice graph(*fancy, value);
+        Profile::Scope scope(Profile::PHASE_ENCODE);
+        encoder_.encode(*band, 0, rows, text);
+
+        if (top > 0)
+        {
+            sink("\n", 1);
+            result++;
+        }
+
+        sink(text.data(), text.length());
+        result += text.length();
+    }
+
+    return result;
+}
+
+template <typename ...Arguments>
+BoxPtr Renderer::makeBox(Arguments &&...arguments)
+{
+    return std::allocate_shared<Box>(std::pmr::polymorphic_allocator<Box>(arena_),
+                                     std::forward<Arguments>(arguments)...,
+                                     arena_);
+}
+
+BoxPtr Renderer::renderGlyph(char value)
+{
+    const Glyph *glyph = font_->get(value);
+
+    if (glyph == NULL)
+    {
+        value = '?';
+        glyph = font_->get(value);
+    }
+
+    std::shared_ptr<const Lattice> &lattice = glyphs_[value - Font::firstCharacter];
+
+    if (lattice == nullptr)
+    {
+        // the box covers the lattice's ids, so making it doesn't take one
+        const unsigned int id = Lattice::currentId;
+        lattice = std::make_shared<const Lattice>(glyph->rows,
+                                                  glyph->width,
+                                                  glyph->height,
+                                                  value);
+        Lattice::currentId = id;
+    }
+
+    return makeBox(lattice);
+}
+
+BoxPtr Renderer::renderDivideBar(BoxPtr &top, BoxPtr &bottom)
+{
+    if (font_->get('-') == NULL)
+    {
+        return makeBox();
+    }
+
+    BoxPtr bar = renderGlyph('-');
+    bar->removeBlankLines();
+
+    // each piece of the bar gets its own color when alternating
+    return Box::makeRule(*bar,
+                         std::max(top->getWidth(), bottom->getWidth()),
+                         colorMode_ == COLOR_MODE_ALTERNATING);
+}
+
+BoxPtr Renderer::renderString(const std::string &maths)
+{
+    BoxPtr result = makeBox();
+    char previousValue = 0;
+
+    for (char value : maths)
+    {
+        BoxPtr graph = renderGlyph(value);
 
         if (previousValue == '-')
         {
@@ -139,12 +412,12 @@ LatticePtr Renderer::renderString(const std::string &maths)
     return result;
 }
 
-bool Renderer::isSingleLine(LatticePtr &graph) const
+bool Renderer::isSingleLine(BoxPtr &graph) const
 {
     return graph->getHeight() <= font_->getMaxHeight();
 }
 
-void Renderer::engroup(LatticePtr &graph)
+void Renderer::engroup(BoxPtr &graph)
 {
     if (graph->isGrouped())
     {
@@ -160,16 +433,16 @@ void Renderer::engroup(LatticePtr &graph)
     {
         // 'graph' isn't very tall, so just enclose it in parentheses, like: (x)
 
-        LatticePtr left = renderString("(");
-        LatticePtr right = renderString(")");
+        BoxPtr left = renderString("(");
+        BoxPtr right = renderString(")");
 
         if (colorMode_ == COLOR_MODE_GROUPED)
         {
             left->setId(*right);
         }
 
-        graph->addToLeft(*left.get());
-        graph->addToRight(*right.get());
+        graph->addToLeft(left);
+        graph->addToRight(right);
     }
     else
     {
@@ -183,57 +456,53 @@ void Renderer::engroup(LatticePtr &graph)
         //  -     -
         //
 
-        LatticePtr cap = renderString("_");
+        BoxPtr cap = renderString("_");
         cap->removeBlankLines();
-        LatticePtr pipe = renderString("|");
+        BoxPtr pipe = renderString("|");
         pipe->removeBlankLines();
-        Lattice leftBar(*cap);
-        Lattice rightBar(*cap);
 
-        const int x = rightBar.getWidth() - pipe->getWidth();
+        // the right pipes line up with the right of the caps
+        const uint32_t x = (cap->getWidth() > pipe->getWidth()
+                            ? cap->getWidth() - pipe->getWidth()
+                            : 0);
 
         // add a little breathing room (+1)
-        while (leftBar.getHeight() <= graph->getHeight() + 1)
-        {
-            leftBar.addToBottom(*pipe);
-            rightBar.addToBottom(*pipe, x);
-        }
-
-        leftBar.addToBottom(*cap);
-        rightBar.addToBottom(*cap);
+        BoxPtr leftBar = Box::makeBracket(*cap, *pipe, graph->getHeight() + 1, 0);
+        BoxPtr rightBar = Box::makeBracket(*cap, *pipe, graph->getHeight() + 1, x);
 
         if (colorMode_ == COLOR_MODE_GROUPED)
         {
-            leftBar.setId(rightBar);
+            leftBar->setId(*rightBar);
         }
 
         graph->engroup(leftBar, rightBar);
     }
 }
 
-bool Renderer::isTall(LatticePtr &lattice) const
+bool Renderer::isTall(BoxPtr &box) const
 {
-    return lattice->getHeight() > (2 * font_->getMaxHeight());
+    return box->getHeight() > (2 * font_->getMaxHeight());
 }
 
-LatticePtr Renderer::renderArguments(const dcArray *arguments)
+BoxPtr Renderer::renderArguments(std::vector<MathNodePtr>::const_iterator begin,
+                                 std::vector<MathNodePtr>::const_iterator end)
 {
-    LatticePtr comma = renderString(",");
+    BoxPtr comma = renderString(",");
     const uint32_t bumpUp = comma->getHeight() - 1;
-    LatticePtr renderedArguments = std::unique_ptr<Lattice>(new Lattice());
+    BoxPtr renderedArguments = makeBox();
     bool needGroup = false;
 
-    for (size_t i = 0; i < arguments->size; i++)
+    for (auto that = begin; that != end; that++)
     {
-        LatticePtr rendered = render(arguments->objects[i]);
-        Position added = renderedArguments->addToRight(*rendered);
+        BoxPtr rendered = render(**that);
+        Position added = renderedArguments->addToRight(rendered);
 
-        if (i > 0 || ! rendered->isGrouped())
+        if (that != begin || ! rendered->isGrouped())
         {
             needGroup = true;
         }
 
-        if (i < arguments->size - 1)
+        if (that + 1 != end)
         {
             // we need to add a comma, but we can't do it right away
             // mark where the comma will go, and raise it up a little
@@ -249,97 +518,85 @@ LatticePtr Renderer::renderArguments(const dcArray *arguments)
     }
 
     // finally insert the commas
-    renderedArguments->paste(*comma);
+    renderedArguments->paste(comma);
     return renderedArguments;
 }
 
-LatticePtr Renderer::renderAssignment(const dcNode *assignment, bool topLevel)
+BoxPtr Renderer::renderAssignment(const MathNode &assignment, bool topLevel)
 {
-    dcNode *value = dcAssignment_getValue(assignment);
-    LatticePtr left = render(dcAssignment_getIdentifier(assignment), topLevel);
-    LatticePtr equals = renderString("=");
-    LatticePtr right = render(value, topLevel);
+    const MathNode &value = *assignment.children[1];
+    BoxPtr left = render(*assignment.children[0], topLevel);
+    BoxPtr equals = renderString("=");
+    BoxPtr right = render(value, topLevel);
 
-    left->addToRight(*equals);
+    left->addToRight(equals);
 
-    NodeType type = TaffyBridge::getInstance().getNodeType(value);
-
-    if (type != NODE_FLAT_ARITHMETIC_RAISE && isTall(right))
+    if (value.kind != MathNode::KIND_RAISE && isTall(right))
     {
-        left->addToRightMiddle(*right);
+        left->addToRightMiddle(right);
     }
     else
     {
-        left->addToRight(*right);
+        left->addToRight(right);
     }
 
     return left;
 }
 
-LatticePtr Renderer::renderNilClass(const dcNode *node, bool topLevel)
+BoxPtr Renderer::renderText(const MathNode &node, bool topLevel)
 {
-    return renderString("");
+    return renderString(node.text);
 }
 
-LatticePtr Renderer::renderFunctionClass(const dcNode *node, bool topLevel)
+BoxPtr Renderer::renderNested(const MathNode &node, bool topLevel)
 {
-    // dcFunctionClass_getBody() can modify its argument so we must pass in
-    // a non-const dcNode*
-    dcNode *copy = dcNode_copy(node, DC_DEEP);
-    LatticePtr result = render(dcFunctionClass_getBody(copy));
-    dcNode_free(&copy, DC_DEEP);
-    return result;
+    return render(*node.children.front());
 }
 
-LatticePtr Renderer::renderIdentifier(const dcNode *node, bool topLevel)
+BoxPtr Renderer::renderCall(const MathNode &node, bool topLevel)
 {
-    return renderString(dcIdentifier_getName(node));
-}
+    BoxPtr name = render(*node.children.front());
+    BoxPtr renderedArguments = renderArguments(node.children.begin() + 1,
+                                               node.children.end());
 
-LatticePtr Renderer::renderGraphDataTree(const dcNode *node, bool topLevel)
-{
-    return render(dcGraphDataTree_getContents(node));
+    // add the arguments to the name
+    name->addToRightMiddle(renderedArguments);
+
+    return name;
 }
 
-LatticePtr Renderer::renderMethodCall(const dcNode *node, bool topLevel)
+// collapse head divides into 'values', like: (a/b)/c is a/b/c
+static void mergeDivide(const MathNode &divide, std::vector<const MathNode *> &values)
 {
-    const dcMethodCall *call = CAST_METHOD_CALL(node);
-
-    // only render a method call that has 1 argument, and that argument
-    // must be an array object
-    if (! (call->arguments->size == 1
-           && dcArrayClass_isMe(dcList_getHead(call->arguments))))
+    for (const MathNodePtr &value : divide.children)
     {
-        return nullptr;
+        if (values.empty() && value->kind == MathNode::KIND_DIVIDE)
+        {
+            mergeDivide(*value, values);
+        }
+        else
+        {
+            values.push_back(value.get());
+        }
     }
-
-    LatticePtr name = render(call->receiver);
-    LatticePtr renderedArguments = renderArguments(dcArrayClass_getObjects(dcList_getHead(call->arguments)));
-
-    // add the arguments to the name
-    name->addToRightMiddle(*renderedArguments);
-
-    return name;
 }
 
-LatticePtr Renderer::renderFlatArithmeticDivide(const dcNode *node, bool topLevel)
+BoxPtr Renderer::renderDivide(const MathNode &node, bool topLevel)
 {
-    dcFlatArithmetic *arithmetic = dcFlatArithmetic_copy(CAST_FLAT_ARITHMETIC(node), DC_DEEP);
-
-    // collapse head divides
-    dcFlatArithmetic_mergeDivide(arithmetic);
+    std::vector<const MathNode *> values;
+    mergeDivide(node, values);
 
-    LatticePtr result = std::unique_ptr<Lattice>(new Lattice());
-    LatticePtr top = render(arithmetic->values->head->object);
-    result->addToBottomCenter(*top.get());
+    BoxPtr result = makeBox();
+    BoxPtr top = render(*values.front());
+    result->addToBottomCenter(top);
 
-    for (dcListElement *that = arithmetic->values->head->next; that != NULL; that = that->next)
+    for (auto that = values.begin() + 1; that != values.end(); that++)
     {
-        LatticePtr bottom = render(that->object);
-        LatticePtr divideBar = renderDivideBar(top, bottom);
+        BoxPtr bottom = render(**that);
+        BoxPtr divideBar = renderDivideBar(top, bottom);
 
-        result->addToBottomCenter(*divideBar.get());
-        result->addToBottomCenter(*bottom.get());
+        result->addToBottomCenter(divideBar);
+        result->addToBottomCenter(bottom);
 
         top = std::move(bottom);
     }
@@ -350,71 +607,67 @@ LatticePtr Renderer::renderFlatArithmeticDivide(const dcNode *node, bool topLeve
         engroup(result);
     }
 
-    dcFlatArithmetic_free(&arithmetic, DC_DEEP);
     return result;
 }
 
-LatticePtr Renderer::renderFlatArithmeticRaise(const dcNode *node, bool topLevel)
+BoxPtr Renderer::renderRaise(const MathNode &node, bool topLevel)
 {
-    LatticePtr result = std::unique_ptr<Lattice>(new Lattice());
-    const dcFlatArithmetic *arithmetic = CAST_FLAT_ARITHMETIC(node);
+    BoxPtr result = makeBox();
 
-    FOR_EACH_IN_LIST(arithmetic->values, value)
+    for (const MathNodePtr &value : node.children)
     {
-        LatticePtr rendered = render(value->object);
+        BoxPtr rendered = render(*value);
 
-        if (dcFlatArithmetic_isGrouped(value->object))
+        if (value->grouped)
         {
             engroup(rendered);
         }
 
-        result->addToTopRight(*rendered);
+        result->addToTopRight(rendered);
     }
 
     return result;
 }
 
-// Render a flat arithmetic that isn't a divide or raise
-LatticePtr Renderer::renderFlatArithmetic(const dcNode *node, bool topLevel)
+// Render an arithmetic that isn't a divide or raise
+BoxPtr Renderer::renderArithmetic(const MathNode &node, bool topLevel)
 {
-    LatticePtr result = std::unique_ptr<Lattice>(new Lattice());
-    const dcFlatArithmetic *arithmetic = CAST_FLAT_ARITHMETIC(node);
+    BoxPtr result = makeBox();
 
-    FOR_EACH_IN_LIST(arithmetic->values, value)
+    for (const MathNodePtr &value : node.children)
     {
-        LatticePtr rendered = render(value->object);
-        NodeType type = TaffyBridge::getInstance().getNodeType(value->object);
+        BoxPtr rendered = render(*value);
 
         // engroup appropriate objects
-        if ((dcFlatArithmetic_isGrouped(value->object)
-             && type != NODE_FLAT_ARITHMETIC_RAISE
-             && type != NODE_FLAT_ARITHMETIC_DIVIDE)
-            || (isTall(rendered) && type != NODE_METHOD_CALL))
+        if ((value->grouped
+             && value->kind != MathNode::KIND_RAISE
+             && value->kind != MathNode::KIND_DIVIDE)
+            || (isTall(rendered) && value->kind != MathNode::KIND_CALL))
         {
             engroup(rendered);
         }
 
-        if (value->previous == NULL)
+        if (value == node.children.front())
         {
             // it's the first, so just add it
-            result->addToRight(*rendered);
+            result->addToRight(rendered);
         }
         else
         {
             // it's not the first, so add the next element
-            LatticePtr separator = renderString(dcSystem_getOperatorSymbol(arithmetic->taffyOperator));
+            BoxPtr separator = renderString(node.text);
 
-            separator->addToRightMiddle(*rendered, defaultSpacing_);
+            separator->addToRightMiddle(rendered, defaultSpacing_);
 
             if (isSingleLine(result) && isSingleLine(separator))
             {
                 // everything is a 'single line', so add to the bottom
-                result->addToRight(*separator);
+                result->addToRight(separator);
             }
             else
             {
                 // it's not a 'single line', so center everything around the middle
-                result->addToRightMiddle(*separator, defaultSpacing_);
+                result->addToRightMiddle(separator, defaultSpacing_);
             }
         }
     }
@@ -422,63 +675,122 @@ LatticePtr Renderer::renderFlatArithmetic(const dcNode *node, bool topLevel)
     return result;
 }
 
-// Render a taffy dcNode
-LatticePtr Renderer::render(const dcNode *node, bool topLevel)
+// Render a MathNode
+BoxPtr Renderer::render(const MathNode &node, bool topLevel)
 {
-    typedef LatticePtr (Renderer::*NodeRenderFunction)(const dcNode *node, bool topLevel);
-    LatticePtr result = nullptr;
+    static_assert(Profile::PHASE_RENDER_FUNCTION_UPDATE - Profile::PHASE_RENDER_TEXT + 1
+                  == MathNode::KIND_COUNT,
+                  "every kind needs a phase");
 
-    const std::unordered_map<NodeType, NodeRenderFunction> renderMap = {
-        {NODE_CLASS_NIL,              &Renderer::renderNilClass},
-        {NODE_CLASS_FUNCTION,         &Renderer::renderFunctionClass},
-        {NODE_FLAT_ARITHMETIC_DIVIDE, &Renderer::renderFlatArithmeticDivide},
-        {NODE_FLAT_ARITHMETIC_RAISE,  &Renderer::renderFlatArithmeticRaise},
-        {NODE_FLAT_ARITHMETIC_OTHER,  &Renderer::renderFlatArithmetic},
-        {NODE_FUNCTION_UPDATE,        &Renderer::renderFunctionUpdate},
-        {NODE_ASSIGNMENT,             &Renderer::renderAssignment},
-        {NODE_GRAPH_DATA_TREE,        &Renderer::renderGraphDataTree},
-        {NODE_METHOD_CALL,            &Renderer::renderMethodCall}
-    };
+    Profile::Scope scope((Profile::Phase)(Profile::PHASE_RENDER_TEXT + node.kind));
 
-    auto found = renderMap.find(TaffyBridge::getInstance().getNodeType(node));
+    // text is quicker to render than to copy, and a tree that's only seen
+    // where its parent is comes with its parent's memo
+    const unsigned int count = shapeCounts_[node.shape];
+    const bool memoize = (node.kind != MathNode::KIND_TEXT
+                          && count > 1
+                          && count > parentCount_);
+    const uint64_t key = ((uint64_t)node.shape << 1) | topLevel;
 
-    if (found != renderMap.end())
+    if (memoize)
     {
-        result = (this->*found->second)(node, topLevel);
+        auto found = memos_.find(key);
+
+        if (found != memos_.end())
+        {
+            const Memo &memo = found->second;
+            BoxPtr result = makeBox(*memo.box);
+
+            Profile::count(Profile::COUNTER_MEMO_HITS);
+
+            result->shiftIds(Lattice::currentId - memo.firstId);
+            Lattice::currentId += memo.idCount;
+
+            return result;
+        }
     }
-    else
+
+    typedef BoxPtr (Renderer::*NodeRenderFunction)(const MathNode &node, bool topLevel);
+
+    // indexed by kind
+    static constexpr NodeRenderFunction renderers[] = {
+        &Renderer::renderText,
+        &Renderer::renderNested,
+        &Renderer::renderDivide,
+        &Renderer::renderRaise,
+        &Renderer::renderArithmetic,
+        &Renderer::renderCall,
+        &Renderer::renderAssignment,
+        &Renderer::renderFunctionUpdate
+    };
+
+    static_assert(sizeof(renderers) / sizeof(renderers[0]) == MathNode::KIND_COUNT,
+                  "every kind needs a renderer");
+
+    const unsigned int firstId = Lattice::currentId;
+    const unsigned int parentCount = parentCount_;
+
+    parentCount_ = count;
+    BoxPtr result = (this->*renderers[node.kind])(node, topLevel);
+    parentCount_ = parentCount;
+
+    if (memoize)
     {
-        // this type doesn't require any special rendering, or we failed rendering
-        char *displayed = dcNode_synchronizedDisplay(node);
-        result = renderString(displayed);
-        dcMemory_free(displayed);
+        if (memos_.size() >= maxMemos)
+        {
+            memos_.clear();
+        }
+
+        // the render is in the arena, so the memo is drawn out of it
+        BoxPtr box = std::make_shared<Box>(*result, std::pmr::get_default_resource());
+        box->flatten();
+        memos_[key] = {box, firstId, Lattice::currentId - firstId};
     }
 
     return result;
 }
 
-LatticePtr Renderer::renderFunctionUpdate(const dcNode *node, bool topLevel)
+void Renderer::intern(MathNode &node)
 {
-    const dcFunctionUpdate *update = CAST_FUNCTION_UPDATE(node);
-    dcArray *arguments = dcArray_createFromList(update->arguments, DC_SHALLOW);
+    Shape shape = {node.kind, node.text, node.grouped, {}};
+    shape.children.reserve(node.children.size());
+
+    for (const MathNodePtr &child : node.children)
+    {
+        intern(*child);
+        shape.children.push_back(child->shape);
+    }
+
+    auto found = shapes_.emplace(std::move(shape), shapeCounts_.size());
 
-    LatticePtr result = render(update->identifier);
-    LatticePtr renderedArguments = renderArguments(arguments);
-    LatticePtr equals = compileAndRenderString("=");
-    LatticePtr renderedArithmetic = render(update->arithmetic, topLevel);
+    if (found.second)
+    {
+        shapeCounts_.push_back(0);
+    }
 
-    result->addToRightMiddle(*renderedArguments);
-    result->addToRightMiddle(*equals);
-    result->addToRightMiddle(*renderedArithmetic);
+    node.shape = found.first->second;
+    shapeCounts_[node.shape]++;
+}
+
+BoxPtr Renderer::renderFunctionUpdate(const MathNode &node, bool topLevel)
+{
+    BoxPtr result = render(*node.children.front());
+    BoxPtr renderedArguments = renderArguments(node.children.begin() + 1,
+                                               node.children.end() - 1);
+    BoxPtr equals = renderString("=");
+    BoxPtr renderedArithmetic = render(*node.children.back(), topLevel);
+
+    result->addToRightMiddle(renderedArguments);
+    result->addToRightMiddle(equals);
+    result->addToRightMiddle(renderedArithmetic);
 
-    dcArray_free(&arguments, DC_SHALLOW);
     return result;
 }
 
-LatticePtr Renderer::tryToRenderAssignment(const std::string &maths)
+BoxPtr Renderer::tryToRenderAssignment(const std::string &maths)
 {
     size_t found = maths.find('=');
-    LatticePtr result(nullptr);
+    BoxPtr result(nullptr);
 
     if (maths == "=")
     {
@@ -501,12 +813,14 @@ LatticePtr Renderer::tryToRenderAssignment(const std::string &maths)
 
         std::string leftString = maths.substr(0, found - 1);
         std::string rightString = maths.substr(foundEnd, maths.length());
-        LatticePtr left = compileAndRenderString(leftString);
-        LatticePtr right = compileAndRenderString(rightString);
-        LatticePtr equals = compileAndRenderString(equalsString);
+        BoxPtr left = compileAndRenderString(leftString);
+        BoxPtr right = compileAndRenderString(rightString);
 
-        left->addToRightMiddle(*equals.get(), defaultSpacing_);
-        left->addToRightMiddle(*right.get(), defaultSpacing_);
+        // there's nothing to parse in the equals, so don't
+        BoxPtr equals = renderString(equalsString);
+
+        left->addToRightMiddle(equals, defaultSpacing_);
+        left->addToRightMiddle(right, defaultSpacing_);
 
         result = std::move(left);
     }
@@ -514,21 +828,38 @@ LatticePtr Renderer::tryToRenderAssignment(const std::string &maths)
     return result;
 }
 
-LatticePtr Renderer::compileAndRenderString(const std::string &maths)
+BoxPtr Renderer::compileAndRenderString(const std::string &maths)
 {
-    dcNode *output = TaffyBridge::getInstance().evaluate(maths);
-    LatticePtr graph(nullptr);
+    // most input is plain algebra that we can parse ourselves, but
+    // anything else goes to Taffy
+    MathNodePtr tree;
 
-    if (output != NULL)
     {
-        graph = render(output, true);
+        Profile::Scope scope(Profile::PHASE_PARSE);
+        tree = MathParser(maths).parse();
     }
 
-    if (output == NULL || graph == nullptr)
+    if (tree == nullptr)
     {
-        // evaluation failed, so just render the string
-        graph = renderString(maths);
+        tree = TaffyBridge::getInstance().parse(maths);
     }
 
-    return graph;
+    if (tree == nullptr)
+    {
+        // parsing failed, so just render the string
+        return renderString(maths);
+    }
+
+    if (shapes_.size() >= maxShapes)
+    {
+        // start over, rather than grow without end
+        shapes_.clear();
+        shapeCounts_.clear();
+        memos_.clear();
+    }
+
+    intern(*tree);
+    parentCount_ = 0;
+
+    return render(*tree, true);
 }
@@ -22,14 +22,20 @@
 #ifndef __RENDERER_H__
 #define __RENDERER_H__
 
+#include <array>
+#include <functional>
 #include <string>
 #include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
 
+#include "AnsiEncoder.h"
 #include "Font.h"
-#include "Lattice.h"
+#include "RenderCache.h"
+#include "Box.h"
 #include "Color.h"
-
-using LatticePtr = std::unique_ptr<Lattice>;
+#include "MathNode.h"
 
 class Renderer
 {
@@ -44,7 +50,11 @@ public:
     // throws std::runtime_error
     static ColorMode getColorMode(std::string input);
 
-    Renderer(Font *font, ColorMode colorMode, bool randomColors = true, int defaultSpacing = 1);
+    Renderer(Font *font,
+             ColorMode colorMode,
+             bool randomColors = true,
+             AnsiEncoder::Palette palette = AnsiEncoder::PALETTE_BASIC,
+             int defaultSpacing = 1);
     virtual ~Renderer();
 
     Renderer &operator=(const Renderer &other) = delete;
@@ -52,38 +62,162 @@ public:
 
     std::string render(const std::string &maths);
 
+    // a streamed render is written to a Sink a piece at a time
+    typedef std::function<void (const char *text, size_t length)> Sink;
+
+    //
+    // render 'maths' to 'sink'. a render bigger than 'bandSize' elements is
+    // drawn and encoded a band of rows at a time, right from its layout, so
+    // neither all of its lattice nor all of its text is ever in memory.
+    // such a render isn't cached
+    //
+    // returns the length of the text
+    //
+    size_t render(const std::string &maths, const Sink &sink);
+
+    // the most elements drawn at once by a streamed render
+    static const size_t bandSize = 64 * 1024;
+
+    // look up and store renders in 'cache', or in nothing if it's NULL
+    void setCache(RenderCache *cache);
+
+    // make the random colors repeatable
+    void setSeed(unsigned long seed);
+
+    // with steady colors, every render uses the same order of colors,
+    // instead of one of its own, so a formula that's being edited keeps
+    // its colors
+    void setSteadyColors(bool steadyColors);
+
 protected:
-    bool isSingleLine(LatticePtr &graph) const;
+    // put the colors in the order for the next render
+    void shuffle();
+
+    // lay out and draw 'maths' without coloring it
+    std::shared_ptr<const Lattice> layout(const std::string &maths);
+
+    // lay out 'maths', and hand the layout to 'use' before it's released
+    template <typename Use>
+    void layout(const std::string &maths, Use use);
 
-    void engroup(LatticePtr &graph);
+    // the number of rows in a band 'width' elements wide
+    static size_t getBandHeight(size_t width);
+
+    // encode 'lattice', or draw and encode 'graph', to 'sink' a band at a
+    // time
+    // returns the length of the text
+    size_t stream(const Lattice &lattice, const Sink &sink);
+    size_t stream(const Box &graph, const Sink &sink);
+
+    bool isSingleLine(BoxPtr &graph) const;
+
+    void engroup(BoxPtr &graph);
 
     // 'top level' render
-    LatticePtr render(const dcNode *node, bool topLevel = false);
+    // a tree that's been rendered before, in this render or an earlier one,
+    // is copied instead, see 'memos_'
+    BoxPtr render(const MathNode &node, bool topLevel = false);
+
+    // give 'node', and everything under it, its shape
+    void intern(MathNode &node);
 
-    LatticePtr tryToRenderAssignment(const std::string &maths);
-    LatticePtr renderString(const std::string &maths);
-    LatticePtr renderDivideBar(LatticePtr &top, LatticePtr &bottom);
-    LatticePtr renderArguments(const dcArray *arguments);
+    BoxPtr tryToRenderAssignment(const std::string &maths);
+    BoxPtr renderString(const std::string &maths);
+    BoxPtr renderDivideBar(BoxPtr &top, BoxPtr &bottom);
+    BoxPtr renderArguments(std::vector<MathNodePtr>::const_iterator begin,
+                           std::vector<MathNodePtr>::const_iterator end);
 
-    LatticePtr renderNilClass(const dcNode *node, bool topLevel);
-    LatticePtr renderFunctionClass(const dcNode *node, bool topLevel);
-    LatticePtr renderFlatArithmeticDivide(const dcNode *node, bool topLevel);
-    LatticePtr renderFlatArithmeticRaise(const dcNode *node, bool topLevel);
-    LatticePtr renderFlatArithmetic(const dcNode *node, bool topLevel);
-    LatticePtr renderFunctionUpdate(const dcNode *node, bool topLevel);
-    LatticePtr renderAssignment(const dcNode *node, bool topLevel);
-    LatticePtr renderGraphDataTree(const dcNode *node, bool topLevel);
-    LatticePtr renderMethodCall(const dcNode *node, bool topLevel);
-    LatticePtr renderIdentifier(const dcNode *node, bool topLevel);
+    BoxPtr renderText(const MathNode &node, bool topLevel);
+    BoxPtr renderNested(const MathNode &node, bool topLevel);
+    BoxPtr renderDivide(const MathNode &node, bool topLevel);
+    BoxPtr renderRaise(const MathNode &node, bool topLevel);
+    BoxPtr renderArithmetic(const MathNode &node, bool topLevel);
+    BoxPtr renderFunctionUpdate(const MathNode &node, bool topLevel);
+    BoxPtr renderAssignment(const MathNode &node, bool topLevel);
+    BoxPtr renderCall(const MathNode &node, bool topLevel);
 
-    LatticePtr compileAndRenderString(const std::string &input);
+    // parse 'input' natively, or with Taffy if that fails, and render it
+    BoxPtr compileAndRenderString(const std::string &input);
 
-    bool isTall(LatticePtr &lattice) const;
+    bool isTall(BoxPtr &box) const;
+
+    // a leaf for 'value', or for '?' if the font doesn't have it
+    BoxPtr renderGlyph(char value);
+
+    // a Box in the current render's arena
+    template <typename ...Arguments>
+    BoxPtr makeBox(Arguments &&...arguments);
 
     Font *font_;
+
+    // the lattice of each glyph, made the first time it's used
+    std::array<std::shared_ptr<const Lattice>, Font::glyphCount> glyphs_;
+
     ColorMode colorMode_;
     bool randomColors_;
+    AnsiEncoder encoder_;
+
+    // whether the colors are reordered only when the seed changes, and
+    // whether they have been since
+    bool steadyColors_;
+    bool shuffled_;
+
     int defaultSpacing_;
+    RenderCache *cache_;
+
+    //
+    // every Box made during a layout comes from one arena, which is released
+    // all at once when the layout is drawn. it starts in 'arenaBuffer_',
+    // which is kept between renders, so most renders never touch the heap.
+    // 'arena_' is only meaningful during a layout
+    //
+    std::pmr::memory_resource *arena_;
+    std::vector<char> arenaBuffer_;
+
+    //
+    // trees are hash-consed: each distinct tree is interned as a shape,
+    // which is its kind, text and grouping and the shapes of its children,
+    // so finding a tree again takes one lookup per node
+    //
+    struct Shape
+    {
+        bool operator==(const Shape &other) const;
+
+        int kind;
+        std::string text;
+        bool grouped;
+        std::vector<unsigned int> children;
+    };
+
+    struct ShapeHash
+    {
+        size_t operator()(const Shape &shape) const;
+    };
+
+    std::unordered_map<Shape, unsigned int, ShapeHash> shapes_;
+
+    // how many times each shape has been seen
+    std::vector<unsigned int> shapeCounts_;
+
+    //
+    // a shape that's seen more than once is drawn into a leaf when it's
+    // first rendered, and each render of it after that copies the leaf,
+    // shifting its ids to where the render would have put them. they're
+    // found by shape, and whether they're top level
+    //
+    struct Memo
+    {
+        BoxPtr box;
+
+        // the ids the render took
+        unsigned int firstId;
+        unsigned int idCount;
+    };
+
+    std::unordered_map<uint64_t, Memo> memos_;
+
+    // the count of the shape being rendered, while its children are
+    unsigned int parentCount_;
 };
 
 #endif
@@ -16,8 +16,25 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include "Profile.h"
 #include "TaffyBridge.h"
 
+// the node evaluator of a registered thread, freed when the thread exits
+struct ThreadEvaluator
+{
+    ~ThreadEvaluator()
+    {
+        if (evaluator != NULL)
+        {
+            dcNodeEvaluator_free(&evaluator);
+        }
+    }
+
+    dcNodeEvaluator *evaluator = NULL;
+};
+
+static thread_local ThreadEvaluator sThreadEvaluator;
+
 TaffyBridge &TaffyBridge::getInstance()
 {
     static TaffyBridge theInstance;
@@ -25,38 +42,226 @@ TaffyBridge &TaffyBridge::getInstance()
 }
 
 TaffyBridge::TaffyBridge()
+    : started_(false)
 {
-    dcSystem_create();
 }
 
 TaffyBridge::~TaffyBridge()
 {
-    dcSystem_free();
+    if (started_)
+    {
+        dcSystem_free();
+    }
+}
+
+void TaffyBridge::start()
+{
+    std::call_once(startFlag_, [this] {
+            Profile::Scope scope(Profile::PHASE_START);
+
+            // we only parse, so skip initializing the classes that only
+            // evaluation needs
+            static char program[] = "ppm";
+            static char minimal[] = "--minimal-bootstrap";
+            char *arguments[] = {program, minimal};
+
+            dcSystem_createWithArguments
+                (dcTaffyCommandLineArguments_parseAndCreate(2, arguments));
+            creator_ = std::this_thread::get_id();
+            started_ = true;
+        });
 }
 
 static void *evalString(void *argument)
 {
     std::string *text = (std::string *)argument;
-    dcNode *result = dcParser_parseString(text->c_str(), "PPMYO", true);
+    // no parse error handling, since that leaves an exception behind that
+    // breaks the next evaluation
+    return dcParser_parseString(text->c_str(), "PPMYO", false);
+}
 
-    if (result != NULL
-        && dcGraphDataTree_isMe(result))
+dcNode *TaffyBridge::evaluate(const std::string &text)
+{
+    std::string input(text);
+    start();
+    registerThread();
+
+    dcNodeEvaluator *evaluator = (sThreadEvaluator.evaluator != NULL
+                                  ? sThreadEvaluator.evaluator
+                                  : dcSystem_getCurrentNodeEvaluator());
+    return (dcNode *)dcNodeEvaluator_synchronizeFunctionCall(evaluator,
+                                                             &evalString,
+                                                             &input);
+}
+
+MathNodePtr TaffyBridge::parse(const std::string &input)
+{
+    Profile::Scope scope(Profile::PHASE_EVALUATE);
+    dcNode *output = evaluate(input);
+    MathNodePtr result;
+
+    if (output != NULL)
     {
-        dcNode *save = result;
-        dcNode *head = dcGraphDataTree_getContents(result);
-        result = dcNode_setTemplate(dcNode_copy(head, DC_DEEP), true);
-        dcNode_free(&save, DC_DEEP);
+        // render what's in the tree, in place
+        result = convert(dcGraphDataTree_isMe(output)
+                         ? dcGraphDataTree_getContents(output)
+                         : output);
+        dcNode_free(&output, DC_DEEP);
     }
 
     return result;
 }
 
-dcNode *TaffyBridge::evaluate(const std::string &text)
+MathNodePtr TaffyBridge::convert(const dcNode *node) const
 {
-    std::string input(text);
-    return (dcNode *)dcNodeEvaluator_synchronizeFunctionCall(dcSystem_getCurrentNodeEvaluator(),
-                                                             &evalString,
-                                                             &input);
+    MathNodePtr result;
+
+    switch (getNodeType(node))
+    {
+    case NODE_CLASS_NIL:
+        result.reset(new MathNode(MathNode::KIND_TEXT));
+        break;
+
+    case NODE_CLASS_FUNCTION:
+        result = convertNested(dcFunctionClass_getBody(node));
+        break;
+
+    case NODE_GRAPH_DATA_TREE:
+        result = convertNested(dcGraphDataTree_getContents(node));
+        break;
+
+    case NODE_FLAT_ARITHMETIC_DIVIDE:
+        result = convertArithmetic(node, MathNode::KIND_DIVIDE);
+        break;
+
+    case NODE_FLAT_ARITHMETIC_RAISE:
+        result = convertArithmetic(node, MathNode::KIND_RAISE);
+        break;
+
+    case NODE_FLAT_ARITHMETIC_OTHER:
+        result = convertArithmetic(node, MathNode::KIND_ARITHMETIC);
+        break;
+
+    case NODE_METHOD_CALL:
+    {
+        const dcMethodCall *call = CAST_METHOD_CALL(node);
+
+        // only a method call that has 1 argument, and that argument an
+        // array object, can be rendered
+        if (call->arguments->size == 1
+            && dcArrayClass_isMe(dcList_getHead(call->arguments)))
+        {
+            const dcArray *arguments =
+                dcArrayClass_getObjects(dcList_getHead(call->arguments));
+            result.reset(new MathNode(MathNode::KIND_CALL));
+            result->children.push_back(convert(call->receiver));
+
+            for (size_t i = 0; i < arguments->size; i++)
+            {
+                result->children.push_back(convert(arguments->objects[i]));
+            }
+        }
+
+        break;
+    }
+
+    case NODE_ASSIGNMENT:
+        result.reset(new MathNode(MathNode::KIND_ASSIGNMENT));
+        result->children.push_back(convert(dcAssignment_getIdentifier(node)));
+        result->children.push_back(convert(dcAssignment_getValue(node)));
+        break;
+
+    case NODE_FUNCTION_UPDATE:
+    {
+        const dcFunctionUpdate *update = CAST_FUNCTION_UPDATE(node);
+        result.reset(new MathNode(MathNode::KIND_FUNCTION_UPDATE));
+        result->children.push_back(convert(update->identifier));
+
+        convertInto(*result, update->arguments);
+        result->children.push_back(convert(update->arithmetic));
+        break;
+    }
+
+    default:
+    {
+        // this type doesn't require any special rendering
+        char *displayed = dcNode_synchronizedDisplay(node);
+        result.reset(new MathNode(MathNode::KIND_TEXT, displayed));
+        dcMemory_free(displayed);
+        break;
+    }
+    }
+
+    // a child that can't be rendered spoils the whole tree
+    if (result != nullptr)
+    {
+        for (const MathNodePtr &child : result->children)
+        {
+            if (child == nullptr)
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    return result;
+}
+
+MathNodePtr TaffyBridge::convertNested(const dcNode *node) const
+{
+    MathNodePtr contents = convert(node);
+    MathNodePtr result;
+
+    if (contents != nullptr)
+    {
+        result.reset(new MathNode(MathNode::KIND_NESTED));
+        result->children.push_back(std::move(contents));
+    }
+
+    return result;
+}
+
+MathNodePtr TaffyBridge::convertArithmetic(const dcNode *node, MathNode::Kind kind) const
+{
+    const dcFlatArithmetic *arithmetic = CAST_FLAT_ARITHMETIC(node);
+    MathNodePtr result(new MathNode(kind,
+                                    dcSystem_getOperatorSymbol(arithmetic->taffyOperator),
+                                    arithmetic->grouped));
+
+    convertInto(*result, arithmetic->values);
+    return result;
+}
+
+void TaffyBridge::convertInto(MathNode &parent, const dcList *nodes) const
+{
+    FOR_EACH_IN_LIST(nodes, that)
+    {
+        parent.children.push_back(convert(that->object));
+    }
+}
+
+void TaffyBridge::registerThread()
+{
+    // the creator uses the system's evaluator, and until Taffy is started,
+    // there's nothing to register with
+    if (started_
+        && sThreadEvaluator.evaluator == NULL
+        && std::this_thread::get_id() != creator_)
+    {
+        // like a Taffy thread, create the evaluator under the parser lock
+        dcParser_lock();
+        sThreadEvaluator.evaluator = dcNodeEvaluator_create();
+        dcParser_unlock();
+    }
+}
+
+void TaffyBridge::unregisterThread()
+{
+    if (sThreadEvaluator.evaluator != NULL)
+    {
+        dcNodeEvaluator_free(&sThreadEvaluator.evaluator);
+        sThreadEvaluator.evaluator = NULL;
+    }
 }
 
 NodeType TaffyBridge::getNodeType(const dcNode *node) const
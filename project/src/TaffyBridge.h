@@ -1,10 +1,15 @@
 #ifndef __TAFFY_BRIDGE_H__
 #define __TAFFY_BRIDGE_H__
 
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "dcTaffy.h"
 
+#include "MathNode.h"
+
 // extra node types
 // start it high enough to be bigger than graph data types
 enum NodeType_e
@@ -28,13 +33,46 @@ public:
     TaffyBridge(const TaffyBridge &other) = delete;
     TaffyBridge &operator=(const TaffyBridge &other) = delete;
 
+    // Taffy is started by the first evaluation, since most input never
+    // needs it, but it can be started sooner
+    void start();
+
+    // parse 'input', which the caller frees, or NULL if Taffy can't
     dcNode *evaluate(const std::string &input);
 
-    NodeType getNodeType(const dcNode *node) const;
+    // evaluate 'input' and convert the result into a MathNode, or nullptr
+    // if Taffy can't parse it, or parses it into something we can't render
+    MathNodePtr parse(const std::string &input);
+
+    // any thread but the one that created the bridge needs its own
+    // node evaluator. a thread is registered when it first evaluates, and
+    // unregistered when it exits, but it can do either sooner
+    void registerThread();
+    void unregisterThread();
 
 protected:
+    // which conversion 'node' takes
+    NodeType getNodeType(const dcNode *node) const;
+
+    MathNodePtr convert(const dcNode *node) const;
+
+    // 'node' converted, as the child of a nested node
+    MathNodePtr convertNested(const dcNode *node) const;
+
+    // 'node', a flat arithmetic, converted into a 'kind' node
+    MathNodePtr convertArithmetic(const dcNode *node, MathNode::Kind kind) const;
+
+    // convert each of 'nodes' into a child of 'parent'
+    void convertInto(MathNode &parent, const dcList *nodes) const;
+
     TaffyBridge();
     virtual ~TaffyBridge();
+
+    std::once_flag startFlag_;
+    std::atomic<bool> started_;
+
+    // the thread that started Taffy
+    std::thread::id creator_;
 };
 
 extern "C"
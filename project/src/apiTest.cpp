@@ -0,0 +1,295 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// Tests the C API, including rendering from many threads at once
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ppm.h"
+
+static bool totalSuccess = true;
+
+#define expectTrue(value)                       \
+    expect(value, #value, __func__, __LINE__)
+
+static void expect(bool value, const char *text, const char *func, int line)
+{
+    if (! value)
+    {
+        std::cout << "-----------\n"
+                  << "Error at: " << func
+                  << ", apiTest.cpp:" << line
+                  << ": " << text << "\n";
+
+        // sticky
+        totalSuccess = false;
+    }
+}
+
+static const std::vector<std::string> sInputs = {
+    "x + 3",
+    "sin(x) + e^2",
+    "1/(1+1/x)",
+    "f(x) = x^2",
+    "(x + 1)^2 / 7",
+    "sum(i, 1, 10, i^2)"
+};
+
+// render with the two-call protocol
+static std::string render(PPMContext *context, const std::string &input)
+{
+    const long length = PPM_renderToBuffer(context, input.c_str(), NULL, 0);
+
+    if (length < 0)
+    {
+        return std::string("Error: ") + PPM_getError(context);
+    }
+
+    std::vector<char> buffer(length + 1);
+    const long second = PPM_renderToBuffer(context, input.c_str(), buffer.data(), buffer.size());
+
+    return (second == length
+            ? std::string(buffer.data(), length)
+            : "Error: the length changed");
+}
+
+// render every input 'rounds' times with a context of its own
+static std::vector<std::string> renderAll(const char *font, size_t rounds)
+{
+    std::vector<std::string> result;
+    PPMContext *context = PPM_createContext();
+    PPM_setFont(context, font);
+    PPM_setColorMode(context, "grouped");
+    PPM_setSeed(context, 42);
+
+    for (size_t i = 0; i < rounds; i++)
+    {
+        for (const std::string &input : sInputs)
+        {
+            result.push_back(render(context, input));
+        }
+    }
+
+    PPM_freeContext(context);
+    return result;
+}
+
+void testOptions()
+{
+    PPMContext *context = PPM_createContext();
+    expectTrue(context != NULL);
+
+    expectTrue(PPM_setFont(context, "no such font") == -1);
+    expectTrue(std::string(PPM_getError(context)) != "");
+    expectTrue(PPM_setColorMode(context, "plaid") == -1);
+    expectTrue(PPM_setPalette(context, "truecolor") == 0);
+    expectTrue(std::string(PPM_getError(context)) == "");
+    expectTrue(PPM_setColorMode(context, "none") == 0);
+
+    // without color, the result is just the glyphs
+    char buffer[4096];
+    const long length = PPM_renderToBuffer(context, "1", buffer, sizeof(buffer));
+    expectTrue(length > 0
+               && std::string(buffer).length() == (size_t)length
+               && std::string(buffer).find('\033') == std::string::npos);
+
+    // a buffer that's too small is left alone
+    char small[4] = "abc";
+    expectTrue(PPM_renderToBuffer(context, "1", small, sizeof(small)) == length);
+    expectTrue(std::string(small) == "abc");
+
+    PPM_freeContext(context);
+}
+
+void testSeed()
+{
+    // the same seed gives the same colors
+    expectTrue(renderAll("small", 2) == renderAll("small", 2));
+}
+
+void testThreads()
+{
+    const std::vector<const char *> fonts = {"small", "big", "banner", "smscript"};
+    std::vector<std::vector<std::string>> expected;
+    std::vector<std::vector<std::string>> results(fonts.size());
+    std::vector<std::thread> threads;
+
+    for (const char *font : fonts)
+    {
+        expected.push_back(renderAll(font, 5));
+    }
+
+    for (size_t i = 0; i < fonts.size(); i++)
+    {
+        threads.push_back(std::thread([&results, &fonts, i] {
+                    results[i] = renderAll(fonts[i], 5);
+                }));
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    expectTrue(results == expected);
+}
+
+static void appendText(const char *text, size_t length, void *data)
+{
+    ((std::string *)data)->append(text, length);
+}
+
+void testStream()
+{
+    // big enough to be drawn a band at a time
+    std::string input = "f(x";
+
+    for (size_t i = 0; i < 5000; i++)
+    {
+        input += ", x";
+    }
+
+    input += ")";
+
+    // a render is the same however it's written out
+    std::string streamed;
+    PPMContext *context = PPM_createContext();
+    PPM_setSeed(context, 42);
+    const long length = PPM_renderToCallback(context, input.c_str(), &appendText, &streamed);
+    PPM_setSeed(context, 42);
+    const std::string buffered = render(context, input);
+    expectTrue(length > 0
+               && (size_t)length == streamed.length()
+               && streamed == buffered);
+
+    // and again from the cache, and to a file
+    FILE *file = tmpfile();
+    expectTrue(file != NULL);
+    PPM_setSeed(context, 42);
+    expectTrue(PPM_renderToFd(context, input.c_str(), fileno(file)) == length);
+
+    std::string written(length, '\0');
+    rewind(file);
+    expectTrue(fread(&written[0], 1, length, file) == (size_t)length
+               && written == buffered);
+
+    fclose(file);
+    PPM_freeContext(context);
+}
+
+static void setRow(size_t row, const char *text, size_t length, void *data)
+{
+    std::vector<std::string> &rows = *(std::vector<std::string> *)data;
+    rows.resize(std::max(rows.size(), row + 1));
+    rows[row].assign(text, length);
+}
+
+// the rows of 'input', rendered by itself
+static std::vector<std::string> renderRows(const std::string &input)
+{
+    std::vector<std::string> result;
+    PPMContext *context = PPM_createContext();
+    PPM_setSeed(context, 42);
+    PPM_renderChanges(context, input.c_str(), &setRow, &result);
+    PPM_freeContext(context);
+    return result;
+}
+
+void testChanges()
+{
+    const std::vector<std::string> inputs = {"x", "x + 1", "(x + 1)/2", "(x + 1)/2^y", "(x + 1)/2^y"};
+    PPMContext *context = PPM_createContext();
+    PPM_setSeed(context, 42);
+    std::vector<std::string> rows;
+
+    for (const std::string &input : inputs)
+    {
+        // the changed rows turn the last render into this one
+        std::vector<std::string> changed;
+        const long count = PPM_renderChanges(context, input.c_str(), &setRow, &changed);
+        size_t changes = 0;
+
+        rows.resize(count);
+
+        for (size_t i = 0; i < changed.size(); i++)
+        {
+            if (! changed[i].empty())
+            {
+                rows[i] = changed[i];
+                changes++;
+            }
+        }
+
+        expectTrue(rows == renderRows(input));
+
+        // nothing changes when the input doesn't
+        expectTrue(&input != &inputs.back() || changes == 0);
+    }
+
+    PPM_freeContext(context);
+}
+
+void testProfile()
+{
+    PPMContext *context = PPM_createContext();
+    expectTrue(context != NULL);
+
+    // nothing is recorded until profiling is on
+    expectTrue(PPM_renderToBuffer(context, "x+1", NULL, 0) > 0);
+    PPM_setProfiling(context, 1);
+    expectTrue(std::string(PPM_getProfile(context)).find("\"renders\": 0") != std::string::npos);
+
+    char buffer[4096];
+    expectTrue(PPM_renderToBuffer(context, "x+2", buffer, sizeof(buffer)) > 0);
+
+    const std::string profile = PPM_getProfile(context);
+    expectTrue(profile.find("\"renders\": 1,") != std::string::npos
+               && profile.find("\"layout\": ") != std::string::npos);
+
+    PPM_freeContext(context);
+}
+
+int main()
+{
+    typedef void (*Test)(void);
+
+    const std::vector<Test> tests = {&testOptions,
+                                     &testSeed,
+                                     &testThreads,
+                                     &testStream,
+                                     &testChanges,
+                                     &testProfile};
+
+    for (const Test test : tests)
+    {
+        std::cout << ".";
+        test();
+    }
+
+    std::cout << "\n";
+    return (totalSuccess
+            ? 0
+            : 1);
+}
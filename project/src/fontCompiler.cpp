@@ -0,0 +1,221 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// fontCompiler turns flf files into headers that hold EmbeddedFont tables,
+// so the fonts that ship with ppm are compiled into it
+//
+// usage: fontCompiler <output directory> <flf file>...
+//
+// each font gets a <name>Font.h, and EmbeddedFonts.h includes them all and
+// lists them in sEmbeddedFonts
+//
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Font.h"
+
+// the font's name, from its path
+static std::string getName(const std::string &path)
+{
+    const size_t slash = path.find_last_of('/');
+    std::string name = (slash == std::string::npos
+                        ? path
+                        : path.substr(slash + 1));
+    const size_t dot = name.rfind('.');
+
+    return (dot == std::string::npos
+            ? name
+            : name.substr(0, dot));
+}
+
+// 'name' capitalized, for identifiers
+static std::string capitalize(std::string name)
+{
+    name[0] = toupper(name[0]);
+    return name;
+}
+
+// 'name' in capitals, for include guards
+static std::string upper(std::string name)
+{
+    for (char &value : name)
+    {
+        value = toupper(value);
+    }
+
+    return name;
+}
+
+// 'text' as a C++ string literal, a line per glyph row
+static void writeLiteral(std::ostream &out, const std::string &text, size_t width)
+{
+    for (size_t start = 0; start < text.length(); start += width)
+    {
+        out << "        \"";
+
+        for (size_t i = start; i < std::min(start + width, text.length()); i++)
+        {
+            const char value = text[i];
+
+            if (value == '\\' || value == '"' || value == '?')
+            {
+                out << '\\' << value;
+            }
+            else if (isprint((unsigned char)value))
+            {
+                out << value;
+            }
+            else
+            {
+                char octal[8];
+                snprintf(octal, sizeof(octal), "\\%03o", (unsigned char)value);
+                out << octal;
+            }
+        }
+
+        out << "\"\n";
+    }
+}
+
+static void compile(const std::string &path, const std::string &outputDirectory)
+{
+    std::ifstream infile(path);
+
+    if (! infile)
+    {
+        throw std::runtime_error(std::string("can't open font file: ") + path);
+    }
+
+    const Font font(infile);
+    const std::string name = getName(path);
+    const std::string identifier = "s" + capitalize(name) + "Font";
+    std::string rows;
+    std::vector<Font::GlyphEntry> entries;
+
+    for (char value = Font::firstCharacter; value <= Font::lastCharacter; value++)
+    {
+        const Glyph *glyph = font.get(value);
+        entries.push_back({(uint32_t)rows.length(), glyph->width, glyph->height});
+        rows.append(glyph->rows, glyph->width * glyph->height);
+    }
+
+    std::ofstream out(outputDirectory + "/" + name + "Font.h");
+
+    out << "//\n"
+        << "// generated by fontCompiler from " << name << ".flf, don't edit\n"
+        << "//\n"
+        << "#ifndef __" << upper(name) << "_FONT_H__\n"
+        << "#define __" << upper(name) << "_FONT_H__\n"
+        << "\n"
+        << "#include \"Font.h\"\n"
+        << "\n"
+        << "static constexpr char " << identifier << "Rows[] =\n";
+
+    // the rows are split by glyph
+    for (const Font::GlyphEntry &entry : entries)
+    {
+        writeLiteral(out,
+                     rows.substr(entry.offset, entry.width * entry.height),
+                     std::max(entry.width, (uint32_t)1));
+    }
+
+    out << "        \"\";\n"
+        << "\n"
+        << "static constexpr EmbeddedFont " << identifier << " =\n"
+        << "{\n"
+        << "    \"" << name << "\",\n"
+        << "    " << font.getMaxHeight() << ",\n"
+        << "    {\n";
+
+    for (const Font::GlyphEntry &entry : entries)
+    {
+        out << "        {" << entry.offset
+            << ", " << entry.width
+            << ", " << entry.height
+            << "},\n";
+    }
+
+    out << "    },\n"
+        << "    " << identifier << "Rows\n"
+        << "};\n"
+        << "\n"
+        << "#endif\n";
+
+    if (! out)
+    {
+        throw std::runtime_error(std::string("can't write font: ") + name);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: fontCompiler <output directory> <flf file>...\n";
+        return 1;
+    }
+
+    const std::string outputDirectory = argv[1];
+    std::ostringstream includes;
+    std::ostringstream fonts;
+
+    try
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            compile(argv[i], outputDirectory);
+
+            const std::string name = getName(argv[i]);
+            includes << "#include \"" << name << "Font.h\"\n";
+            fonts << "    &s" << capitalize(name) << "Font,\n";
+        }
+    }
+    catch (std::exception &exception)
+    {
+        std::cerr << "Error: " << exception.what() << "\n";
+        return 1;
+    }
+
+    std::ofstream out(outputDirectory + "/EmbeddedFonts.h");
+
+    out << "//\n"
+        << "// generated by fontCompiler, don't edit\n"
+        << "//\n"
+        << "#ifndef __EMBEDDED_FONTS_H__\n"
+        << "#define __EMBEDDED_FONTS_H__\n"
+        << "\n"
+        << includes.str()
+        << "\n"
+        << "static constexpr const EmbeddedFont *sEmbeddedFonts[] =\n"
+        << "{\n"
+        << fonts.str()
+        << "};\n"
+        << "\n"
+        << "#endif\n";
+
+    return (out
+            ? 0
+            : 1);
+}
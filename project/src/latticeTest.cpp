@@ -16,11 +16,16 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
 #include <iostream>
 #include <cassert>
 #include <vector>
 
+#include "AnsiEncoder.h"
+#include "Color.h"
 #include "Lattice.h"
+#include "Box.h"
+#include "RenderCache.h"
 
 #define expectEqual(left, right)                \
     expect(left, right, __func__, __LINE__)
@@ -32,7 +37,8 @@ static void expect(const Lattice &left, const Lattice &right, const char *func,
     bool success = true;
 
     if (left.getWidth() != right.getWidth()
-        || left.getHeight() != right.getHeight())
+        || left.getHeight() != right.getHeight()
+        || left.convertToString(false, false) != right.convertToString(false, false))
     {
         std::cout << "-----------\n"
                   << "Error at: " << func
@@ -76,6 +82,23 @@ void testPaste()
     expectEqual(lattice, Lattice({ "ccc", "cac"}, 'z'));
 }
 
+void testPasteMarksAfterGrowing()
+{
+    // marks stay with their elements, and are pasted all at once
+    Lattice lattice({ "ab", "  ", "cd" }, 'a');
+    lattice.mark(Position(0, 0));
+    lattice.mark(Position(1, 2));
+    lattice.prependColumns(1);
+    lattice.prependRows(1);
+    lattice.removeBlankLines();
+    lattice.paste(Lattice({ "x" }, 'x'));
+    expectEqual(lattice, Lattice({ " xb", " cx" }, 'a'));
+
+    // and only once
+    lattice.paste(Lattice({ "y" }, 'y'));
+    expectEqual(lattice, Lattice({ " xb", " cx" }, 'a'));
+}
+
 void testPrepend()
 {
     Lattice lattice({ "a" }, 'a');
@@ -109,12 +132,272 @@ void testAddToRight()
     expectEqual(lattice, Lattice({"   a", "   a", "ccca", "ccca"}, 'z'));
 }
 
+void testGrowAllDirections()
+{
+    Lattice lattice({ "a" }, 'a');
+
+    for (int i = 0; i < 20; i++)
+    {
+        lattice.prependColumns(1);
+        lattice.appendColumns(1);
+        lattice.prependRows(1);
+        lattice.appendRows(1);
+    }
+
+    std::vector<std::string> expected(41, std::string(41, ' '));
+    expected[20][20] = 'a';
+    expectEqual(lattice, Lattice(expected, 'a'));
+
+    lattice.removeBlankLines();
+    expectEqual(lattice, Lattice({ expected[20] }, 'a'));
+}
+
+void testRemoveBlankLines()
+{
+    Lattice lattice({ "   ", "a b", "   ", " c ", "   " }, 'a');
+    lattice.removeBlankLines();
+    expectEqual(lattice, Lattice({ "a b", " c " }, 'a'));
+
+    // the slack left behind must be blank
+    lattice.appendRows(1);
+    expectEqual(lattice, Lattice({ "a b", " c ", "   " }, 'a'));
+}
+
 void testSquish()
 {
     Lattice left({"---"}, '-');
     Lattice right({" - "}, '-');
     left.addToRightSquished(right);
-    expectEqual(left, Lattice({"----"}, '-'));
+    expectEqual(left, Lattice({"--- "}, '-'));
+}
+
+void testBoxMatchesLattice()
+{
+    const std::vector<std::string> glyph = { " - ", "---" };
+    Lattice lattice({ "ab", "cd" }, 'a');
+    BoxPtr box = std::make_shared<Box>(std::vector<std::string>{ "ab", "cd" }, 'a');
+
+    Lattice tall({ "x", "x", "x" }, 'x');
+    BoxPtr tallBox = std::make_shared<Box>(std::vector<std::string>{ "x", "x", "x" }, 'x');
+
+    lattice.addToLeft(tall);
+    box->addToLeft(tallBox);
+    lattice.addToTopRight(tall);
+    box->addToTopRight(tallBox);
+    lattice.addToRightSquished(Lattice(glyph, '-'));
+    box->addToRightSquished(std::make_shared<Box>(glyph, '-'));
+    lattice.addToBottomCenter(tall);
+    box->addToBottomCenter(tallBox);
+
+    expectEqual(*box->draw(), lattice);
+}
+
+void testStamp()
+{
+    Lattice lattice(7, 2);
+    lattice.stamp(Lattice({ "abc", "def" }, 'a'), 0, 0, 3, 2, 0, 1);
+    expectEqual(lattice, Lattice({ "bcbcbc ", "efefef " }, 'a'));
+
+    Lattice column(1, 4);
+    column.stamp(Lattice({ "x" }, 'x'), 0, 1, 2, 0, 2);
+    expectEqual(column, Lattice({ " ", "x", " ", "x" }, 'x'));
+}
+
+void testRuleMatchesSquish()
+{
+    const std::vector<std::string> glyph = { " ___ ", "|___|" };
+
+    for (size_t width = 0; width < 12; width++)
+    {
+        BoxPtr piece = std::make_shared<Box>(glyph, '-');
+        BoxPtr squished = std::make_shared<Box>();
+
+        while (squished->getWidth() <= width)
+        {
+            squished->addToRightSquished(piece);
+        }
+
+        expectEqual(*Box::makeRule(*piece, width, false)->draw(), *squished->draw());
+    }
+}
+
+void testBracketMatchesStack()
+{
+    const std::vector<std::string> capGlyph = { " ____ " };
+    const std::vector<std::string> pipeGlyph = { "| |", "| |" };
+
+    for (size_t height = 0; height < 8; height++)
+    {
+        BoxPtr cap = std::make_shared<Box>(capGlyph, '_');
+        BoxPtr pipe = std::make_shared<Box>(pipeGlyph, '|');
+        BoxPtr stacked = std::make_shared<Box>(*cap);
+
+        while (stacked->getHeight() <= height)
+        {
+            stacked->addToBottom(pipe, 3);
+        }
+
+        stacked->addToBottom(cap);
+        expectEqual(*Box::makeBracket(*cap, *pipe, height, 3)->draw(), *stacked->draw());
+    }
+}
+
+void testPackedRows()
+{
+    auto lattice = std::make_shared<const Lattice>("abcd", 2, 2, 'a');
+    expectEqual(*lattice, Lattice({ "ab", "cd" }, 'a'));
+
+    // boxes can share a lattice
+    Box box(lattice);
+    box.addToRight(std::make_shared<Box>(lattice));
+    expectEqual(*box.draw(), Lattice({ "abab", "cdcd" }, 'a'));
+}
+
+void testEncoder()
+{
+    Lattice::currentId = 0;
+    Lattice lattice({ "ab c" }, 'a');
+    lattice.addToBottom(Lattice({ "de" }, 'd'));
+    const AnsiEncoder encoder(AnsiEncoder::PALETTE_BASIC, false);
+
+    // a code when the color changes, none for spaces, a reset per line
+    const std::string expected = (Color::red.getCode() + "ab c" + Color::end.getCode()
+                                  + "\n"
+                                  + Color::green.getCode() + "de  " + Color::end.getCode());
+    const std::string result = encoder.encode(lattice);
+
+    if (result != expected || result.length() > encoder.getMaxLength(lattice))
+    {
+        std::cout << "-----------\n"
+                  << "Error at: " << __func__ << ": " << result << "\n";
+        totalSuccess = false;
+    }
+
+    // a buffer that's too small gets what fits, and the length that's needed
+    char buffer[8];
+
+    if (encoder.encode(lattice, buffer, sizeof(buffer)) != expected.length()
+        || std::string(buffer, sizeof(buffer)) != expected.substr(0, sizeof(buffer)))
+    {
+        std::cout << "-----------\n"
+                  << "Error at: " << __func__ << ": buffer\n";
+        totalSuccess = false;
+    }
+}
+
+void testEncoderAfterRemovingLines()
+{
+    // the ids stay with their elements when a blank line between them goes
+    Lattice::currentId = 0;
+    Lattice lattice({ "a" }, 'a');
+    lattice.addToBottom(Lattice({ " " }, ' '));
+    lattice.addToBottom(Lattice({ "bc" }, 'b'));
+    lattice.prependColumns(1);
+    lattice.removeBlankLines();
+
+    Lattice::currentId = 0;
+    Lattice expected({ " a" }, 'a');
+    Lattice::currentId = 2;
+    expected.addToBottom(Lattice({ " bc" }, 'b'));
+
+    const AnsiEncoder encoder(AnsiEncoder::PALETTE_BASIC, false);
+
+    if (encoder.encode(lattice) != encoder.encode(expected))
+    {
+        std::cout << "-----------\n"
+                  << "Error at: " << __func__ << ": " << encoder.encode(lattice) << "\n";
+        totalSuccess = false;
+    }
+}
+
+void testShiftIds()
+{
+    // a shifted copy is colored like the same boxes made with later ids,
+    // and the box it's copied from isn't shifted
+    const std::vector<std::string> ab = { "ab" };
+    const std::vector<std::string> cd = { "cd" };
+    const AnsiEncoder encoder(AnsiEncoder::PALETTE_BASIC, false);
+
+    Lattice::currentId = 0;
+    BoxPtr box = std::make_shared<Box>(ab, 'a');
+    box->addToRight(std::make_shared<Box>(cd, 'c'));
+    const std::string unshifted = encoder.encode(*box->draw());
+
+    Box shifted(*box);
+    shifted.shiftIds(3);
+
+    Lattice::currentId = 3;
+    BoxPtr expected = std::make_shared<Box>(ab, 'a');
+    expected->addToRight(std::make_shared<Box>(cd, 'c'));
+
+    if (encoder.encode(*shifted.draw()) != encoder.encode(*expected->draw())
+        || encoder.encode(*box->draw()) != unshifted)
+    {
+        std::cout << "-----------\n"
+                  << "Error at: " << __func__ << ": " << encoder.encode(*shifted.draw()) << "\n";
+        totalSuccess = false;
+    }
+}
+
+void testDrawBands()
+{
+    // drawing and encoding a box a band of rows at a time, and joining the
+    // bands with newlines, gives the same text as doing it all at once
+    const AnsiEncoder encoder(AnsiEncoder::PALETTE_BASIC, false);
+
+    Lattice::currentId = 0;
+    BoxPtr box = std::make_shared<Box>(std::vector<std::string>{ "ab", "cd", "ef" }, 'a');
+    box->addToBottom(std::make_shared<Box>(std::vector<std::string>{ " g" }, 'g'), 1);
+    box->addToRight(std::make_shared<Box>(std::vector<std::string>{ "h", "i" }, 'h'));
+    const std::string expected = encoder.encode(*box->draw());
+
+    for (size_t bandHeight = 1; bandHeight <= box->getHeight(); bandHeight++)
+    {
+        std::string result;
+        std::string band;
+
+        for (size_t top = 0; top < box->getHeight(); top += bandHeight)
+        {
+            const size_t height = std::min(bandHeight, box->getHeight() - top);
+            encoder.encode(*box->draw(top, height), 0, height, band);
+            result += (top > 0 ? "\n" : "") + band;
+        }
+
+        if (result != expected)
+        {
+            std::cout << "-----------\n"
+                      << "Error at: " << __func__ << ": " << bandHeight << ": " << result << "\n";
+            totalSuccess = false;
+        }
+    }
+}
+
+void testRenderCache()
+{
+    RenderCache cache(2);
+    const auto x = std::make_shared<const Lattice>(std::vector<std::string>{ "x" }, 'x');
+    const auto y = std::make_shared<const Lattice>(std::vector<std::string>{ "y" }, 'y');
+    const auto z = std::make_shared<const Lattice>(std::vector<std::string>{ "z" }, 'z');
+
+    cache.insert({"x", NULL, 0, 1}, x);
+    cache.insert({"y", NULL, 0, 1}, y);
+
+    // using x makes y the least recently used, so z pushes it out
+    const bool foundX = (cache.find({"x", NULL, 0, 1}) == x);
+    cache.insert({"z", NULL, 0, 1}, z);
+
+    if (! foundX
+        || cache.find({"y", NULL, 0, 1}) != nullptr
+        || cache.find({"x", NULL, 0, 1}) != x
+        || cache.find({"z", NULL, 1, 1}) != nullptr
+        || cache.getSize() != 2
+        || cache.getHits() != 2
+        || cache.getMisses() != 2)
+    {
+        std::cout << "-----------\n"
+                  << "Error at: " << __func__ << "\n";
+        totalSuccess = false;
+    }
 }
 
 int main()
@@ -122,10 +405,23 @@ int main()
     typedef void (*Test)(void);
 
     const std::vector<Test> tests = {&testPaste,
+                                     &testPasteMarksAfterGrowing,
                                      &testSquish,
                                      &testPrepend,
                                      &testAppend,
-                                     &testAddToRight};
+                                     &testAddToRight,
+                                     &testGrowAllDirections,
+                                     &testRemoveBlankLines,
+                                     &testBoxMatchesLattice,
+                                     &testStamp,
+                                     &testRuleMatchesSquish,
+                                     &testBracketMatchesStack,
+                                     &testPackedRows,
+                                     &testEncoder,
+                                     &testEncoderAfterRemovingLines,
+                                     &testShiftIds,
+                                     &testDrawBands,
+                                     &testRenderCache};
 
     for (const Test test : tests)
     {
@@ -134,5 +430,7 @@ int main()
     }
 
     std::cout << "\n";
-    return 0;
+    return (totalSuccess
+            ? 0
+            : 1);
 }
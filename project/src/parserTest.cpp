@@ -0,0 +1,239 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// Tests MathParser, mostly by checking that it builds the same tree that
+// Taffy does for anything it accepts
+//
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MathParser.h"
+#include "TaffyBridge.h"
+
+static bool totalSuccess = true;
+
+#define expectTrue(value)                       \
+    expect(value, #value, __func__, __LINE__)
+
+static void expect(bool value, const char *text, const char *func, int line)
+{
+    if (! value)
+    {
+        std::cout << "-----------\n"
+                  << "Error at: " << func
+                  << ", parserTest.cpp:" << line
+                  << ": " << text << "\n";
+
+        // sticky
+        totalSuccess = false;
+    }
+}
+
+// if we parse 'input', Taffy must parse it into the same tree
+static bool agreesWithTaffy(const std::string &input)
+{
+    MathNodePtr tree = MathParser(input).parse();
+
+    if (tree == nullptr)
+    {
+        return true;
+    }
+
+    MathNodePtr taffyTree = TaffyBridge::getInstance().parse(input);
+
+    if (taffyTree == nullptr
+        || taffyTree->convertToString() != tree->convertToString())
+    {
+        std::cout << "\n'" << input << "' parsed into: "
+                  << tree->convertToString()
+                  << "\nbut Taffy parsed it into: "
+                  << (taffyTree == nullptr
+                      ? "nothing"
+                      : taffyTree->convertToString())
+                  << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+void testAccepts()
+{
+    const std::vector<std::string> inputs = {
+        "x + 3",
+        "sin(x) + e^2",
+        "1/(1+1/x)",
+        "(x + 1)^2 / 7",
+        "sum(i2, 1, 10, x^2)",
+        "a - (b - c) - d",
+        "x^-1",
+        "- 4 + 1.50",
+        "b = f(x) * 2"
+    };
+
+    for (const std::string &input : inputs)
+    {
+        expectTrue(MathParser(input).parse() != nullptr);
+        expectTrue(agreesWithTaffy(input));
+    }
+}
+
+void testRejects()
+{
+    // Taffy reads these in ways that we don't
+    const std::vector<std::string> inputs = {
+        "",
+        "2x",
+        "-x",
+        "-4^2",
+        "-4/2",
+        "-0",
+        "x y",
+        "a--4",
+        "1e5",
+        "0x10",
+        "007",
+        "1.",
+        "i",
+        "nil",
+        "f()",
+        "f(a)(b)",
+        "(x+1)(x-1)",
+        "x == y",
+        "b = c = d",
+        "y^2 = x"
+    };
+
+    for (const std::string &input : inputs)
+    {
+        expectTrue(MathParser(input).parse() == nullptr);
+    }
+}
+
+// make something that's mostly algebra, and sometimes not
+static std::string generate(std::default_random_engine &engine, int depth)
+{
+    static const std::vector<std::string> operands = {
+        "x", "y", "e", "pi", "x1", "_y", "X", "0", "1", "2", "10", "3.14",
+        "0.50", "-4", "- 2", "-1.5"
+    };
+    static const std::vector<std::string> oddOperands = {
+        "i", "nil", "in", "007", "1.", "-0", "2x", "-x"
+    };
+    static const std::vector<std::string> operators = {
+        "+", "-", "*", "/", "^"
+    };
+    static const std::vector<std::string> oddOperators = {
+        "%", "=", "==", ""
+    };
+    static const std::string noise = " -()+,.=^2x";
+
+    std::uniform_int_distribution<int> percent(0, 99);
+    auto pick = [&engine](const std::vector<std::string> &from) {
+        return from[std::uniform_int_distribution<size_t>(0, from.size() - 1)(engine)];
+    };
+    auto space = [&]() {
+        return std::string(percent(engine) < 80 ? 0 : 1, ' ');
+    };
+
+    const int choice = (depth > 5
+                        ? 0
+                        : percent(engine));
+    std::string result;
+
+    if (choice < 30)
+    {
+        result = pick(percent(engine) < 95 ? operands : oddOperands);
+    }
+    else if (choice < 40)
+    {
+        result = "(" + space() + generate(engine, depth + 1) + space() + ")";
+    }
+    else if (choice < 50)
+    {
+        result = pick({"f", "sin", "g"}) + space() + "(" + generate(engine, depth + 1);
+
+        while (percent(engine) < 30)
+        {
+            result += "," + space() + generate(engine, depth + 1);
+        }
+
+        result += ")";
+    }
+    else
+    {
+        result = (generate(engine, depth + 1)
+                  + space()
+                  + pick(percent(engine) < 97 ? operators : oddOperators)
+                  + space()
+                  + generate(engine, depth + 1));
+    }
+
+    if (percent(engine) < 1)
+    {
+        const size_t position = std::uniform_int_distribution<size_t>(0, result.size())(engine);
+        result.insert(position, 1, noise[percent(engine) % noise.size()]);
+    }
+
+    return result;
+}
+
+void testRandom()
+{
+    std::default_random_engine engine(1234);
+    size_t accepted = 0;
+
+    for (size_t i = 0; i < 5000; i++)
+    {
+        const std::string input = generate(engine, 0);
+
+        if (MathParser(input).parse() != nullptr)
+        {
+            accepted++;
+        }
+
+        expectTrue(agreesWithTaffy(input));
+    }
+
+    // make sure the test tests something
+    expectTrue(accepted > 1000);
+}
+
+int main()
+{
+    typedef void (*Test)(void);
+
+    const std::vector<Test> tests = {&testAccepts,
+                                     &testRejects,
+                                     &testRandom};
+
+    for (const Test test : tests)
+    {
+        std::cout << ".";
+        test();
+    }
+
+    std::cout << "\n";
+    return (totalSuccess
+            ? 0
+            : 1);
+}
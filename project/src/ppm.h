@@ -0,0 +1,113 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// The C API for embedding ppm
+//
+// Each PPMContext has its own options, random colors and render cache. A
+// context must only be used by one thread at a time, but any number of
+// contexts can render at once from different threads.
+//
+#ifndef __PPM_H__
+#define __PPM_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct PPMContext PPMContext;
+
+// create a context that renders with the small font, alternating colors
+// from the basic palette in a random order, and a render cache of 1024
+// entries
+// returns NULL on failure
+PPMContext *PPM_createContext(void);
+void PPM_freeContext(PPMContext *context);
+
+// the options, which return 0 on success, and -1 for an unknown value
+int PPM_setFont(PPMContext *context, const char *font);
+int PPM_setColorMode(PPMContext *context, const char *colorMode);
+int PPM_setPalette(PPMContext *context, const char *palette);
+void PPM_setRandomColors(PPMContext *context, int randomColors);
+void PPM_setSeed(PPMContext *context, unsigned long seed);
+void PPM_setCacheCapacity(PPMContext *context, size_t capacity);
+
+//
+// render 'input' into 'buffer', which holds 'size' bytes, ending it with a
+// NUL
+//
+// returns the length of the result without the NUL, or -1 on error
+// if the result doesn't fit then nothing is written, and the context keeps
+// it for the next call with the same input, so calling with a NULL buffer
+// and a size of 0, then again with a buffer of the returned length + 1,
+// renders once
+//
+long PPM_renderToBuffer(PPMContext *context, const char *input, char *buffer, size_t size);
+
+//
+// render 'input' a piece at a time, so a big render never has to fit in
+// memory all at once. the pieces are passed to 'write', with 'data', or
+// written to the file descriptor 'fd'. there's no NUL at the end
+//
+// returns the length of the result, or -1 on error. nothing is written
+// if the input can't be rendered
+//
+typedef void (*PPMWriteFunction)(const char *text, size_t length, void *data);
+
+long PPM_renderToCallback(PPMContext *context,
+                          const char *input,
+                          PPMWriteFunction write,
+                          void *data);
+long PPM_renderToFd(PPMContext *context, const char *input, int fd);
+
+//
+// render 'input' as the next version of a formula that's being edited,
+// passing 'row' only the rows that are different from the last render's,
+// in order from the top, with 'data'. the rows have no NUL or newline at
+// the end. the colors stay the same from one render to the next
+//
+// returns the number of rows, so the caller knows how many of its rows
+// are left, or -1 on error, after which every row is passed again
+//
+typedef void (*PPMRowFunction)(size_t row, const char *text, size_t length, void *data);
+
+long PPM_renderChanges(PPMContext *context,
+                       const char *input,
+                       PPMRowFunction row,
+                       void *data);
+
+// the last error of 'context', or an empty string
+const char *PPM_getError(const PPMContext *context);
+
+// with 'profiling' on, the context adds up how long each phase of its
+// renders takes. turning it on starts a new profile
+void PPM_setProfiling(PPMContext *context, int profiling);
+
+// the profile as a JSON object like:
+// {"nanoseconds": {"parse": 1200, ...}, "counts": {"renders": 1, ...}}
+// the context owns the result, which lasts until the next call
+const char *PPM_getProfile(PPMContext *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,368 @@
+//
+// This file is part of ppm, a pretty printer for math
+// Copyright (C) 2018 Nate Smith (nat2e.smith@gmail.com)
+//
+// ppm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ppm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+//
+// ppm_bench renders a corpus of inputs and reports how long each phase
+// took, how much was allocated and how much was written, as JSON
+//
+// usage: ppm_bench [--corpus <file>] [--font <font>] [--color <mode>]
+//                  [--iterations <count>] [--budget <microseconds>]
+//
+// with a budget, it fails if any case takes longer per render
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "FontFactory.h"
+#include "Profile.h"
+#include "Renderer.h"
+#include "TaffyBridge.h"
+
+// every C++ allocation in the program is counted, though Taffy's own,
+// from malloc, aren't
+static unsigned long sAllocations = 0;
+static unsigned long sAllocatedBytes = 0;
+
+void *operator new(size_t size)
+{
+    void *result = std::malloc(size == 0 ? 1 : size);
+
+    if (result == NULL)
+    {
+        throw std::bad_alloc();
+    }
+
+    sAllocations++;
+    sAllocatedBytes += size;
+    return result;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+struct Case
+{
+    std::string name;
+    std::vector<std::string> inputs;
+};
+
+// 1/(1 + 1/(1 + ...)), 'depth' deep
+static std::string makeContinuedFraction(size_t depth)
+{
+    std::string result = "1";
+
+    for (size_t i = 0; i < depth; i++)
+    {
+        result = "1/(1 + " + result + ")";
+    }
+
+    return result;
+}
+
+// 'terms' terms, like: 3x^2 + 2x^1 + 1
+static std::string makePolynomial(size_t terms)
+{
+    std::string result;
+
+    for (size_t i = terms; i > 0; i--)
+    {
+        result += (std::to_string(i) + "*x^" + std::to_string(i - 1)
+                   + (i > 1 ? " + " : ""));
+    }
+
+    return result;
+}
+
+// f(g(f(...), y), y), 'depth' deep
+static std::string makeNestedCalls(size_t depth)
+{
+    std::string result = "x";
+
+    for (size_t i = 0; i < depth; i++)
+    {
+        result = std::string(i % 2 == 0 ? "f(" : "g(") + result + ", y)";
+    }
+
+    return result;
+}
+
+// a call with 'columns' arguments per row, for 'rows' rows, which is the
+// closest ppm has to a matrix
+static std::string makeWideMatrix(size_t rows, size_t columns)
+{
+    std::string result;
+
+    for (size_t row = 0; row < rows; row++)
+    {
+        result += (row > 0 ? " + " : "");
+        result += "m(";
+
+        for (size_t column = 0; column < columns; column++)
+        {
+            result += (std::string(column > 0 ? ", " : "")
+                       + "a" + std::to_string(row) + "/b" + std::to_string(column));
+        }
+
+        result += ")";
+    }
+
+    return result;
+}
+
+static bool readCorpus(const std::string &path, std::vector<std::string> &inputs)
+{
+    std::ifstream file(path);
+    std::string line;
+
+    if (! file)
+    {
+        return false;
+    }
+
+    while (std::getline(file, line))
+    {
+        if (! line.empty())
+        {
+            inputs.push_back(line);
+        }
+    }
+
+    return true;
+}
+
+// a whole, non-negative number, or false
+static bool readCount(const std::string &value, unsigned long &count)
+{
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return false;
+    }
+
+    try
+    {
+        count = std::stoul(value);
+    }
+    catch (const std::out_of_range &)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static void writeCase(std::ostream &out,
+                      const Case &benchCase,
+                      const Profile &profile,
+                      unsigned long allocations,
+                      unsigned long allocatedBytes,
+                      uint64_t perRender)
+{
+    out << "    {\n"
+        << "      \"name\": \"" << benchCase.name << "\",\n"
+        << "      \"inputs\": " << benchCase.inputs.size() << ",\n"
+        << "      \"renders\": " << profile.getCount(Profile::COUNTER_RENDERS) << ",\n"
+        << "      \"nanoseconds\": {";
+
+    for (int phase = Profile::PHASE_START; phase < Profile::PHASE_COUNT; phase++)
+    {
+        out << (phase > Profile::PHASE_START ? ", " : "")
+            << "\"" << Profile::getPhaseName((Profile::Phase)phase) << "\": "
+            << profile.getNanoseconds((Profile::Phase)phase);
+    }
+
+    out << "},\n"
+        << "      \"nanosecondsPerRender\": " << perRender << ",\n"
+        << "      \"allocations\": " << allocations << ",\n"
+        << "      \"allocatedBytes\": " << allocatedBytes << ",\n"
+        << "      \"outputBytes\": " << profile.getCount(Profile::COUNTER_OUTPUT_BYTES) << "\n"
+        << "    }";
+}
+
+int main(int argc, char **argv)
+{
+    std::string corpus = PPM_BENCH_CORPUS;
+    std::string font = "small";
+    std::string colorMode = "alternating";
+    unsigned long iterations = 5;
+    unsigned long budget = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument = argv[i];
+
+        if (i + 1 == argc)
+        {
+            std::cerr << "Error: " << argument << " needs a value\n";
+            return 1;
+        }
+
+        const std::string value = argv[++i];
+
+        if (argument == "--corpus")
+        {
+            corpus = value;
+        }
+        else if (argument == "--font")
+        {
+            font = value;
+        }
+        else if (argument == "--color")
+        {
+            colorMode = value;
+        }
+        else if (argument == "--iterations" || argument == "--budget")
+        {
+            unsigned long &count = (argument == "--iterations" ? iterations : budget);
+
+            if (! readCount(value, count))
+            {
+                std::cerr << "Error: " << argument << " needs a number, not: " << value << "\n";
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "Error: unknown argument: " << argument << "\n";
+            return 1;
+        }
+    }
+
+    iterations = std::max(iterations, 1UL);
+
+    std::vector<Case> cases = {{"examples", {}},
+                               {"continuedFractions", {}},
+                               {"polynomials", {}},
+                               {"nestedCalls", {}},
+                               {"wideMatrices", {}}};
+
+    if (! readCorpus(corpus, cases[0].inputs))
+    {
+        std::cerr << "Error: can't open corpus: " << corpus << "\n";
+        return 1;
+    }
+
+    for (size_t size : {10, 20, 40})
+    {
+        cases[1].inputs.push_back(makeContinuedFraction(size));
+        cases[2].inputs.push_back(makePolynomial(size * 5));
+        cases[3].inputs.push_back(makeNestedCalls(size));
+        cases[4].inputs.push_back(makeWideMatrix(size / 5, size));
+    }
+
+    Font *fontObject = NULL;
+    Renderer::ColorMode mode;
+
+    try
+    {
+        fontObject = FontFactory::getInstance().createFont(font);
+        mode = Renderer::getColorMode(colorMode);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "Error: " << error.what() << "\n";
+        return 1;
+    }
+
+    // start Taffy up front, so it isn't charged to the first case
+    const auto start = std::chrono::steady_clock::now();
+    TaffyBridge::getInstance().start();
+    const auto started = std::chrono::steady_clock::now();
+
+    std::ostringstream out;
+    bool overBudget = false;
+
+    out << "{\n"
+        << "  \"font\": \"" << font << "\",\n"
+        << "  \"colorMode\": \"" << colorMode << "\",\n"
+        << "  \"iterations\": " << iterations << ",\n"
+        << "  \"startNanoseconds\": "
+        << std::chrono::duration_cast<std::chrono::nanoseconds>(started - start).count()
+        << ",\n"
+        << "  \"cases\": [\n";
+
+    for (const Case &benchCase : cases)
+    {
+        // without a cache, so every render is laid out
+        Renderer renderer(fontObject, mode, false);
+        Profile profile;
+        const unsigned long allocations = sAllocations;
+        const unsigned long allocatedBytes = sAllocatedBytes;
+
+        Profile::current = &profile;
+
+        for (unsigned long i = 0; i < iterations; i++)
+        {
+            for (const std::string &input : benchCase.inputs)
+            {
+                renderer.render(input);
+            }
+        }
+
+        Profile::current = NULL;
+
+        uint64_t total = 0;
+
+        for (int phase = Profile::PHASE_START; phase < Profile::PHASE_COUNT; phase++)
+        {
+            total += profile.getNanoseconds((Profile::Phase)phase);
+        }
+
+        const uint64_t perRender = total / std::max(profile.getCount(Profile::COUNTER_RENDERS),
+                                                    1UL);
+
+        if (budget > 0 && perRender > budget * 1000)
+        {
+            std::cerr << "Over budget: " << benchCase.name << " takes "
+                      << perRender / 1000 << " microseconds per render\n";
+            overBudget = true;
+        }
+
+        writeCase(out,
+                  benchCase,
+                  profile,
+                  sAllocations - allocations,
+                  sAllocatedBytes - allocatedBytes,
+                  perRender);
+        out << (&benchCase != &cases.back() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n"
+        << "}\n";
+
+    std::cout << out.str();
+
+    return (overBudget
+            ? 1
+            : 0);
+}